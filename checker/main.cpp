@@ -16,9 +16,13 @@
 
 #include "leviathan.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <limits>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 #include <cstring>
 
@@ -109,6 +113,18 @@ static TCLAP::SwitchArg model(
   "m", "model",
   "Generates and prints a model of the formula, when satisfiable", false);
 
+static TCLAP::ValueArg<uint64_t> models(
+  "", "models",
+  "Generates and prints up to the given number of distinct models of the "
+  "formula, when satisfiable",
+  false, 0, "number");
+
+static TCLAP::SwitchArg shortest(
+  "", "shortest",
+  "Generates and prints a model of the formula with as few states as "
+  "possible, when satisfiable",
+  false);
+
 static TCLAP::SwitchArg parsable("p", "parsable",
                                  "Generates machine-parsable output", false);
 
@@ -135,11 +151,120 @@ static TCLAP::ValueArg<uint64_t> depth(
   "The maximum depth to descend into the tableaux (aka the maximum size of "
   "the model)",
   false, std::numeric_limits<uint64_t>::max(), "number");
+
+static TCLAP::ValueArg<uint32_t> threads(
+  "", "threads",
+  "The number of threads searching the tableau in parallel. Zero means one "
+  "per hardware thread",
+  false, 1, "number");
+
+static TCLAP::ValueArg<uint32_t> cubes(
+  "", "cubes",
+  "Explores the tableau down to the given number of choices, and leaves each "
+  "branch still open there, a cube, to a worker process. Zero means no split",
+  false, 0, "number");
+
+static TCLAP::ValueArg<uint32_t> workers(
+  "", "workers",
+  "The number of worker processes searching the cubes. Zero means one per "
+  "hardware thread",
+  false, 0, "number");
+
+static TCLAP::ValueArg<uint32_t> portfolio(
+  "", "portfolio",
+  "Races the given number of differently configured solvers on each "
+  "formula, one per thread, taking the answer of the first one done. Zero "
+  "means one per hardware thread. It cannot be given together with the "
+  "threads, cubes or strategy options",
+  false, 1, "number");
+
+static TCLAP::ValueArg<double> timeout(
+  "", "timeout",
+  "The maximum time in seconds to spend on each formula. When it runs out "
+  "the answer is UNKNOWN",
+  false, 0, "seconds");
+
+static TCLAP::ValueArg<uint64_t> max_frames(
+  "", "max-frames",
+  "The maximum number of frames to explore for each formula. When they run "
+  "out the answer is UNKNOWN",
+  false, std::numeric_limits<uint64_t>::max(), "number");
+
+static TCLAP::ValueArg<uint64_t> memory(
+  "", "memory",
+  "The maximum memory in MiB held by the search of each formula. When it "
+  "runs out the answer is UNKNOWN",
+  false, 0, "MiB");
+
+static TCLAP::ValueArg<std::string> rules(
+  "", "rules",
+  "The order in which the tableau rules are applied to a state, as a "
+  "comma-separated list with each of conjunction, always, disjunction, "
+  "eventually, until and release once. The contradiction rule always comes "
+  "first",
+  false, "conjunction,always,disjunction,eventually,until,release", "rules");
+
+static std::vector<std::string> branching_values = {
+  "first", "most-constrained", "most-shared", "eventualities", "random"};
+static TCLAP::ValuesConstraint<std::string>
+  branching_constraint(branching_values);
+
+static TCLAP::ValueArg<std::string> branching(
+  "", "branching",
+  "Which pending formula to branch on: the first one, the one with the "
+  "fewest alternatives, the one whose alternatives add the formulas shared "
+  "the most by the others, one fulfilling the eventuality requested for "
+  "the longest time, trying that alternative first, or a random one",
+  false, "first", &branching_constraint);
+
+static std::vector<std::string> alternative_values = {"first", "second"};
+static TCLAP::ValuesConstraint<std::string>
+  alternative_constraint(alternative_values);
+
+static TCLAP::ValueArg<std::string> alternative(
+  "", "first-alternative",
+  "Which alternative of a choice to try first: the first one fulfils "
+  "eventualities right away and takes the left disjunct, the second one "
+  "postpones them and takes the right disjunct",
+  false, "first", &alternative_constraint);
+
+static TCLAP::SwitchArg lookahead(
+  "", "lookahead",
+  "Looks at what each alternative of a choice adds before branching, "
+  "dropping the ones leading to a contradiction and trying first the one "
+  "adding the most formulas",
+  false);
+
+static TCLAP::ValueArg<uint64_t> seed(
+  "", "seed", "The seed of the random branching", false, 0, "number");
+
+static std::vector<std::string> restarts_values = {"none", "luby",
+                                                   "geometric"};
+static TCLAP::ValuesConstraint<std::string>
+  restarts_constraint(restarts_values);
+
+static TCLAP::ValueArg<std::string> restarts(
+  "", "restarts",
+  "Starts the search over after a growing number of frames, keeping what "
+  "has been learned and changing the seed of the random branching: the "
+  "restart interval times the Luby sequence, or growing by half every time. "
+  "Only done with a single thread and before the first model",
+  false, "none", &restarts_constraint);
+
+static TCLAP::ValueArg<uint64_t> restart_interval(
+  "", "restart-interval", "The number of frames before the first restart",
+  false, 1000, "number");
 }
 
+/*
+ * The strategy given on the command line, set on every solver
+ */
+static LTL::Solver::Strategy strategy;
+
 bool solve(std::string const &, boost::optional<size_t> current = boost::none);
 void print_progress_status(LTL::FormulaPtr const&, size_t);
 bool batch(std::string const &);
+LTL::Solver::Strategy parse_strategy();
 void parse(std::string const&formula);
 
 // We suppose 80 columns is a good width
@@ -183,22 +308,103 @@ bool solve(const std::string &input, boost::optional<size_t> current)
   if (current)
     print_progress_status(formula, *current);
 
-  LTL::Solver solver(formula, LTL::FrameID(Args::depth.getValue()));
+  LTL::Solver::Budget budget;
+  budget.frames = Args::max_frames.getValue();
+  if (Args::memory.isSet())
+    budget.memory = size_t(Args::memory.getValue()) << 20;
+  if (Args::timeout.isSet())
+    budget.deadline =
+      LTL::Solver::Clock::now() +
+      std::chrono::duration_cast<LTL::Solver::Clock::duration>(
+        std::chrono::duration<double>(Args::timeout.getValue()));
+
+  std::unique_ptr<LTL::Solver> single;
+  std::unique_ptr<LTL::Portfolio> portfolio;
+  LTL::Solver *solver;
+
+  if (Args::portfolio.isSet()) {
+    uint32_t count = Args::portfolio.getValue();
+    if (count == 0)
+      count = std::max(1u, std::thread::hardware_concurrency());
+
+    auto configurations = LTL::Portfolio::configurations(count);
+    if (Args::depth.isSet())
+      for (auto &configuration : configurations)
+        configuration.maximum_depth =
+          std::min(configuration.maximum_depth,
+                   LTL::FrameID(Args::depth.getValue()));
+
+    portfolio.reset(new LTL::Portfolio(formula, std::move(configurations)));
+    portfolio->set_budget(budget);
+    portfolio->solution();
+
+    solver = portfolio->winner() ? portfolio->winner() : &portfolio->solver(0);
+  }
+  else {
+    single.reset(new LTL::Solver(formula, LTL::FrameID(Args::depth.getValue()),
+                                 Args::threads.getValue()));
+    single->set_budget(budget);
+    single->set_strategy(strategy);
+    if (Args::cubes.isSet())
+      single->set_cubes({Args::cubes.getValue(), Args::workers.getValue()});
+    solver = single.get();
+  }
 
-  solver.solution();
+  LTL::ModelPtr shortest;
+  if (Args::shortest.isSet()) {
+    if (!portfolio || portfolio->winner())
+      shortest = solver->shortest_model();
+  }
+  else if (!portfolio)
+    solver->solution();
 
-  bool sat = solver.satisfiability() == LTL::Solver::Result::SATISFIABLE;
+  bool sat = solver->satisfiability() == LTL::Solver::Result::SATISFIABLE;
+  bool unknown = solver->satisfiability() == LTL::Solver::Result::UNDEFINED;
 
   if (Args::parsable.isSet())
     format::message(format::NoNewLine, "{}",
-                    sat ? colored(Green, "SAT") : colored(Red, "UNSAT"));
+                    sat ? colored(Green, "SAT")
+                        : unknown ? colored(Yellow, "UNKNOWN")
+                                  : colored(Red, "UNSAT"));
+  else if (unknown)
+    format::message(NoNewLine,
+                    "The satisfiability of the formula is {}!",
+                    colored(Yellow, "unknown"));
   else
     format::message(
       NoNewLine, "The formula is {}!",
       sat ? colored(Green, "satisfiable") : colored(Red, "unsatisfiable"));
 
-  if (sat && Args::model.isSet()) {
-    LTL::ModelPtr model = solver.model();
+  if (sat && Args::shortest.isSet()) {
+    if (!Args::parsable.isSet())
+      format::message(solver->state() == LTL::Solver::State::DONE
+                        ? "\nThe shortest model was found:"
+                        : "\nThe following model was found, but the budget "
+                          "ran out before proving it the shortest:");
+    else
+      format::message(NoNewLine, ";");
+    format::message(NoNewLine, "{}",
+                    model_format(shortest, Args::parsable.isSet()));
+  }
+  else if (sat && Args::models.isSet()) {
+    uint64_t count = 0;
+    while (count < Args::models.getValue()) {
+      LTL::ModelPtr model = solver->next_model();
+      if (!model)
+        break;
+
+      if (!Args::parsable.isSet())
+        format::message("\nModel {}:", ++count);
+      else {
+        format::message(NoNewLine, ";");
+        ++count;
+      }
+      format::message(NoNewLine, "{}",
+                      model_format(model, Args::parsable.isSet()));
+    }
+  }
+  else if (sat && Args::model.isSet()) {
+    LTL::ModelPtr model = solver->model();
 
     if (!Args::parsable.isSet())
       format::message("\nThe following model was found:");
@@ -234,6 +440,61 @@ bool batch(std::string const &filename)
   return clean;
 }
 
+LTL::Solver::Strategy parse_strategy()
+{
+  using Rule = LTL::Solver::Strategy::Rule;
+  using Branching = LTL::Solver::Strategy::Branching;
+  static const std::vector<std::pair<std::string, Rule>> names = {
+    {"conjunction", Rule::CONJUNCTION}, {"always", Rule::ALWAYS},
+    {"disjunction", Rule::DISJUNCTION}, {"eventually", Rule::EVENTUALLY},
+    {"until", Rule::UNTIL},             {"release", Rule::RELEASE}};
+
+  LTL::Solver::Strategy result;
+
+  std::stringstream stream(Args::rules.getValue());
+  std::vector<bool> given(names.size(), false);
+  size_t count = 0;
+  std::string name;
+  while (std::getline(stream, name, ',')) {
+    auto it = std::find_if(begin(names), end(names), [&](auto const &rule) {
+      return rule.first == name;
+    });
+    if (it == end(names))
+      format::fatal("Unknown tableau rule \"{}\"", name);
+
+    size_t index = size_t(it - begin(names));
+    if (given[index])
+      format::fatal("The tableau rule \"{}\" is given twice", name);
+
+    given[index] = true;
+    result.rules[count++] = it->second;
+  }
+
+  if (count != names.size())
+    format::fatal("The order of the tableau rules must give each of them");
+
+  if (Args::branching.getValue() == "most-constrained")
+    result.branching = Branching::MOST_CONSTRAINED;
+  else if (Args::branching.getValue() == "most-shared")
+    result.branching = Branching::MOST_SHARED;
+  else if (Args::branching.getValue() == "eventualities")
+    result.branching = Branching::EVENTUALITIES;
+  else if (Args::branching.getValue() == "random")
+    result.branching = Branching::RANDOM;
+
+  result.second_alternative_first = Args::alternative.getValue() == "second";
+  result.lookahead = Args::lookahead.isSet();
+
+  result.seed = Args::seed.getValue();
+  if (Args::restarts.getValue() == "luby")
+    result.restarts = LTL::Solver::Strategy::Restarts::LUBY;
+  else if (Args::restarts.getValue() == "geometric")
+    result.restarts = LTL::Solver::Strategy::Restarts::GEOMETRIC;
+  result.restart_interval = Args::restart_interval.getValue();
+
+  return result;
+}
+
 int main(int argc, char *argv[])
 {
   TCLAP::CmdLine cmd("A simple LTL satisfiability checker", ' ',
@@ -242,9 +503,25 @@ int main(int argc, char *argv[])
   using namespace Args;
 
   cmd.add(depth);
+  cmd.add(threads);
+  cmd.add(cubes);
+  cmd.add(workers);
+  cmd.add(portfolio);
+  cmd.add(timeout);
+  cmd.add(max_frames);
+  cmd.add(memory);
+  cmd.add(rules);
+  cmd.add(branching);
+  cmd.add(alternative);
+  cmd.add(lookahead);
+  cmd.add(seed);
+  cmd.add(restarts);
+  cmd.add(restart_interval);
   cmd.add(verbosity);
   cmd.add(parsable);
   cmd.add(model);
+  cmd.add(models);
+  cmd.add(shortest);
   cmd.add(ltl);
   cmd.add(Args::parse);
   cmd.add(filename);
@@ -254,6 +531,19 @@ int main(int argc, char *argv[])
   // Setup the verbosity first of all
   format::set_verbosity_level(verbosity.getValue());
 
+  strategy = parse_strategy();
+
+  // The portfolio configures each of its solvers by itself
+  if (portfolio.isSet()) {
+    const TCLAP::Arg *configured[] = {
+      &threads,     &cubes,     &workers, &rules,    &branching,
+      &alternative, &lookahead, &seed,    &restarts, &restart_interval};
+    for (const TCLAP::Arg *arg : configured)
+      if (arg->isSet())
+        format::fatal("The --{} option cannot be given with --portfolio",
+                      arg->getName());
+  }
+
   // format::verbose("Verbose message. I told you this would be very verbose.");
 
   // Begin to process inputs
@@ -0,0 +1,344 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace LTL {
+namespace detail {
+
+static constexpr size_t BITS_PER_BLOCK = 64;
+
+inline size_t blocks_for(size_t bits)
+{
+  return (bits + BITS_PER_BLOCK - 1) / BITS_PER_BLOCK;
+}
+
+inline size_t lowest_bit(uint64_t block)
+{
+  assert(block != 0);
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, block);
+  return index;
+#else
+  return static_cast<size_t>(__builtin_ctzll(block));
+#endif
+}
+
+// Finalizer of the SplitMix64 generator, a cheap but good 64 bit mixer
+inline uint64_t mix64(uint64_t x)
+{
+  x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return x ^ (x >> 31);
+}
+
+inline size_t popcount(uint64_t block)
+{
+#ifdef _MSC_VER
+  return static_cast<size_t>(__popcnt64(block));
+#else
+  return static_cast<size_t>(__builtin_popcountll(block));
+#endif
+}
+
+/*
+ * Operations shared by the fixed and the dynamic bitsets. The interface is
+ * the subset of boost::dynamic_bitset used by the solver, and everything is
+ * written in terms of whole 64 bit blocks. Derived classes only provide
+ * data() and num_blocks(): when the latter is a constant expression (as in
+ * FixedBitset) the compiler fully unrolls every loop below.
+ */
+template <typename Derived>
+class BitsetBase {
+public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  bool test(size_t pos) const
+  {
+    return (blocks()[pos / BITS_PER_BLOCK] >> (pos % BITS_PER_BLOCK)) & 1;
+  }
+
+  bool operator[](size_t pos) const { return test(pos); }
+
+  Derived &set(size_t pos)
+  {
+    blocks()[pos / BITS_PER_BLOCK] |= uint64_t(1) << (pos % BITS_PER_BLOCK);
+    return self();
+  }
+
+  Derived &set(size_t pos, bool value)
+  {
+    return value ? set(pos) : reset(pos);
+  }
+
+  Derived &reset(size_t pos)
+  {
+    blocks()[pos / BITS_PER_BLOCK] &=
+      ~(uint64_t(1) << (pos % BITS_PER_BLOCK));
+    return self();
+  }
+
+  // Note: this sets the padding bits too. It is only meant to be used on
+  // masks that are ANDed with something else before being inspected.
+  Derived &set()
+  {
+    for (size_t i = 0; i < num_blocks(); ++i)
+      blocks()[i] = ~uint64_t(0);
+    return self();
+  }
+
+  Derived &reset()
+  {
+    for (size_t i = 0; i < num_blocks(); ++i)
+      blocks()[i] = 0;
+    return self();
+  }
+
+  bool any() const
+  {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < num_blocks(); ++i)
+      acc |= blocks()[i];
+    return acc != 0;
+  }
+
+  bool none() const { return !any(); }
+
+  size_t count() const
+  {
+    size_t result = 0;
+    for (size_t i = 0; i < num_blocks(); ++i)
+      result += popcount(blocks()[i]);
+    return result;
+  }
+
+  size_t find_first() const { return find_from(0); }
+
+  size_t find_next(size_t pos) const { return find_from(pos + 1); }
+
+  // Calls f on every set bit in increasing order, a block at a time
+  template <typename F>
+  void for_each(F f) const
+  {
+    for (size_t i = 0; i < num_blocks(); ++i)
+      for (uint64_t block = blocks()[i]; block != 0; block &= block - 1)
+        f(i * BITS_PER_BLOCK + lowest_bit(block));
+  }
+
+  Derived &operator&=(const Derived &other)
+  {
+    for (size_t i = 0; i < num_blocks(); ++i)
+      blocks()[i] &= other.blocks()[i];
+    return self();
+  }
+
+  Derived &operator|=(const Derived &other)
+  {
+    for (size_t i = 0; i < num_blocks(); ++i)
+      blocks()[i] |= other.blocks()[i];
+    return self();
+  }
+
+  Derived &operator^=(const Derived &other)
+  {
+    for (size_t i = 0; i < num_blocks(); ++i)
+      blocks()[i] ^= other.blocks()[i];
+    return self();
+  }
+
+  // Set difference, as in boost::dynamic_bitset
+  Derived &operator-=(const Derived &other)
+  {
+    for (size_t i = 0; i < num_blocks(); ++i)
+      blocks()[i] &= ~other.blocks()[i];
+    return self();
+  }
+
+  Derived &operator>>=(size_t n)
+  {
+    assert(n < BITS_PER_BLOCK);
+    if (n == 0)
+      return self();
+
+    for (size_t i = 0; i + 1 < num_blocks(); ++i)
+      blocks()[i] =
+        (blocks()[i] >> n) | (blocks()[i + 1] << (BITS_PER_BLOCK - n));
+    blocks()[num_blocks() - 1] >>= n;
+
+    return self();
+  }
+
+  bool intersects(const Derived &other) const
+  {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < num_blocks(); ++i)
+      acc |= blocks()[i] & other.blocks()[i];
+    return acc != 0;
+  }
+
+  bool is_subset_of(const Derived &other) const
+  {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < num_blocks(); ++i)
+      acc |= blocks()[i] & ~other.blocks()[i];
+    return acc == 0;
+  }
+
+  uint64_t hash() const
+  {
+    uint64_t result = 0;
+    for (size_t i = 0; i < num_blocks(); ++i)
+      result = mix64(result ^ blocks()[i]) + i;
+    return result;
+  }
+
+  friend bool operator==(const Derived &b1, const Derived &b2)
+  {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < b1.num_blocks(); ++i)
+      acc |= b1.blocks()[i] ^ b2.blocks()[i];
+    return acc == 0;
+  }
+
+  friend bool operator!=(const Derived &b1, const Derived &b2)
+  {
+    return !(b1 == b2);
+  }
+
+  // Copies the content of a bitset of another kind, which must not be wider
+  template <typename Other>
+  Derived &assign(const BitsetBase<Other> &other)
+  {
+    assert(other.num_blocks() <= num_blocks());
+    reset();
+    for (size_t i = 0; i < other.num_blocks(); ++i)
+      blocks()[i] = other.blocks()[i];
+    return self();
+  }
+
+  uint64_t *blocks() { return self().data(); }
+  const uint64_t *blocks() const { return self().data(); }
+  size_t num_blocks() const { return self().num_blocks(); }
+
+private:
+  Derived &self() { return static_cast<Derived &>(*this); }
+  const Derived &self() const { return static_cast<const Derived &>(*this); }
+
+  size_t find_from(size_t pos) const
+  {
+    size_t i = pos / BITS_PER_BLOCK;
+    if (i >= num_blocks())
+      return npos;
+
+    uint64_t block = blocks()[i] & (~uint64_t(0) << (pos % BITS_PER_BLOCK));
+    while (block == 0) {
+      if (++i == num_blocks())
+        return npos;
+      block = blocks()[i];
+    }
+
+    return i * BITS_PER_BLOCK + lowest_bit(block);
+  }
+};
+
+/*
+ * Bitset with a compile-time number of 64 bit blocks, stored inline. The
+ * solver is instantiated on a few of these widths and picks the smallest one
+ * able to hold the closure of the formula.
+ */
+template <size_t Blocks>
+class FixedBitset : public BitsetBase<FixedBitset<Blocks>> {
+public:
+  static constexpr size_t capacity = Blocks * BITS_PER_BLOCK;
+
+  FixedBitset() : _data() {}
+  explicit FixedBitset(size_t size) : _data()
+  {
+    assert(size <= capacity);
+    (void)size;
+  }
+
+  static constexpr size_t num_blocks() { return Blocks; }
+  static constexpr size_t size() { return capacity; }
+
+  uint64_t *data() { return _data; }
+  const uint64_t *data() const { return _data; }
+
+private:
+  uint64_t _data[Blocks];
+};
+
+/*
+ * Non-owning view over blocks stored somewhere else, used for the bitsets of
+ * eventualities at the end of every frame. Copying a view doesn't copy the
+ * bits, assign() does.
+ */
+class BitsetRef : public BitsetBase<BitsetRef> {
+public:
+  BitsetRef(uint64_t *data, size_t num_blocks)
+    : _data(data), _num_blocks(num_blocks)
+  {
+  }
+
+  size_t num_blocks() const { return _num_blocks; }
+
+  uint64_t *data() { return _data; }
+  const uint64_t *data() const { return _data; }
+
+private:
+  uint64_t *_data;
+  size_t _num_blocks;
+};
+
+/*
+ * Heap allocated fallback, for closures too big for any FixedBitset.
+ */
+class DynamicBitset : public BitsetBase<DynamicBitset> {
+public:
+  DynamicBitset() : _size(0), _data() {}
+  explicit DynamicBitset(size_t size)
+    : _size(size), _data(blocks_for(size), 0)
+  {
+  }
+
+  size_t num_blocks() const { return _data.size(); }
+  size_t size() const { return _size; }
+
+  void resize(size_t size)
+  {
+    _size = size;
+    _data.resize(blocks_for(size), 0);
+  }
+
+  uint64_t *data() { return _data.data(); }
+  const uint64_t *data() const { return _data.data(); }
+
+private:
+  size_t _size;
+  std::vector<uint64_t> _data;
+};
+}
+}
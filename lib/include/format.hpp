@@ -183,9 +183,12 @@ inline std::istream &operator>>(std::istream &s, LogLevel &level)
 }
 
 /*
- * Functions to set and probe the verbosity level
+ * Functions to set and probe the verbosity level. The one set for a thread
+ * takes over the global one for everything logged from it, so that solvers
+ * running side by side can be kept quiet.
  */
 void set_verbosity_level(LogLevel level);
+void set_thread_verbosity_level(LogLevel level);
 LogLevel verbosity_level();
 
 template <typename CharTy, typename... Args>
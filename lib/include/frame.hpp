@@ -16,17 +16,17 @@
 
 #pragma once
 
-#include "boost/dynamic_bitset.hpp"
-#include "boost/pool/pool_alloc.hpp"
+#include "bitset.hpp"
 #include "identifiable.hpp"
 
+#include <cassert>
 #include <cstdint>
+#include <memory>
+#include <new>
 
 namespace LTL {
 namespace detail {
 
-using Bitset = boost::dynamic_bitset<uint64_t>;
-
 // TODO: Remove set_ and is_ from functions name
 class Eventuality {
 public:
@@ -40,75 +40,139 @@ private:
   FrameID _id;
 };
 
-using Eventualities =
-  std::vector<Eventuality, boost::fast_pool_allocator<Eventuality>>;
+/*
+ * Non-owning view over a contiguous array, used for the eventualities stored
+ * at the end of every frame
+ */
+template <typename T>
+class ArrayRef {
+public:
+  ArrayRef(T *data, size_t size) : _data(data), _size(size) {}
 
-struct Frame {
-  enum Type : uint8_t { UNKNOWN = 0, STEP = 1, CHOICE = 2 };
+  T *begin() const { return _data; }
+  T *end() const { return _data + _size; }
+  size_t size() const { return _size; }
+  T &operator[](size_t i) const { return _data[i]; }
 
-  Bitset formulas;
-  Bitset to_process;
-  Bitset requests; // stored here as it needs a lookup to get it from `formulas`
-  Eventualities eventualities;
+private:
+  T *_data;
+  size_t _size;
+};
+
+/*
+ * A frame records a fully expanded state of the current branch of the
+ * tableau, at the time the STEP rule is applied to it. Choices inside a state
+ * don't copy frames anymore: the solver keeps a single working state and a
+ * trail of the changes made to it (see tableau.hpp), and the frames are used
+ * for the loop and prune checks and to restore the working state when
+ * backtracking past a STEP.
+ *
+ * Frames are variable-sized records living in the tableau stack (see
+ * stack.hpp): the header fields and the bitsets (inline, when Bitset is one of
+ * the FixedBitset widths) are followed in the same allocation by the bitsets
+ * of eventualities and by the array of eventualities. As such, frames must
+ * only be constructed in place inside a stack built with an element size of
+ * Frame::size_for().
+ *
+ * The bitsets of eventualities are indexed by eventuality, not by formula,
+ * and are as wide as needed for the eventualities alone. `requests` are the
+ * ones requested in the state, and `fulfilled` the ones fulfilled somewhere
+ * between the first frame of the loop and this one. The loop and prune rules
+ * are checked on them, while the array keeps the latest frame in which every
+ * eventuality has been fulfilled, to compute them.
+ *
+ * Bitset is either one of the FixedBitset widths or DynamicBitset, depending
+ * on the size of the closure (see Solver::_make_engine)
+ */
+template <typename Bitset>
+struct Frame {
   FrameID id;
-  FormulaID choosen_formula;
   Frame* chain;
   Frame* first;
   Frame* prev;
-  Type type;
-
-  // Builds a frame with a single formula in it (represented by the index in
-  // the table) -> Start of the process
-  Frame(const FrameID _id, const FormulaID _formula,
-        uint64_t number_of_formulas, uint64_t number_of_eventualities)
-    : formulas(number_of_formulas),
-      to_process(number_of_formulas),
-      requests(number_of_formulas),
-      eventualities(number_of_eventualities),
-      id(_id),
-      choosen_formula(FormulaID::max()),
-      chain(nullptr),
-	  first(nullptr),
-	  prev(nullptr),
-      type(UNKNOWN)
+  Frame* same; // Previous frame of the branch with the same fingerprint
+  uint64_t fingerprint; // Zobrist hash of `formulas`
+  FrameID horizon; // Oldest frame the subtree after this one depends on
+  uint32_t number_of_eventualities;
+  bool stepped; // Whether the subtree after this frame has been explored
+
+  Bitset formulas;
+  Bitset processed;
+
+  static size_t size_for(uint64_t number_of_eventualities)
   {
-    formulas.set(_formula);
-    to_process.set();
+    return sizeof(Frame) +
+           2 * blocks_for(number_of_eventualities) * sizeof(uint64_t) +
+           number_of_eventualities * sizeof(Eventuality);
   }
 
-  // Builds a frame with the same formulas of the given frame in it -> Choice
-  // point
-  Frame(const Frame &_frame)
-    : formulas(_frame.formulas),
-      to_process(_frame.to_process),
-      requests(_frame.requests),
-      eventualities(_frame.eventualities,
-                    _frame.eventualities.get_allocator()),
-      id(_frame.id),
-      choosen_formula(FormulaID::max()),
-      chain(_frame.chain),
-	  first(nullptr),
-	  prev(nullptr),
-      type(UNKNOWN)
+  BitsetRef requests() { return {words(), ev_blocks()}; }
+  const BitsetRef requests() const
   {
+    return {const_cast<uint64_t *>(words()), ev_blocks()};
   }
 
-  // Builds a frame with the given sets of eventualities (needs to be manually
-  // filled with the formulas) -> Step rule
-  Frame(const FrameID _id, uint64_t number_of_formulas,
-        const Eventualities &_eventualities, Frame *chainPtr)
-    : formulas(number_of_formulas),
-      to_process(number_of_formulas),
-      requests(number_of_formulas),
-      eventualities(_eventualities, _eventualities.get_allocator()),
-      id(_id),
-      choosen_formula(FormulaID::max()),
+  BitsetRef fulfilled() { return {words() + ev_blocks(), ev_blocks()}; }
+  const BitsetRef fulfilled() const
+  {
+    return {const_cast<uint64_t *>(words()) + ev_blocks(), ev_blocks()};
+  }
+
+  ArrayRef<Eventuality> eventualities()
+  {
+    return {reinterpret_cast<Eventuality *>(words() + 2 * ev_blocks()),
+            number_of_eventualities};
+  }
+
+  ArrayRef<const Eventuality> eventualities() const
+  {
+    return {reinterpret_cast<const Eventuality *>(words() + 2 * ev_blocks()),
+            number_of_eventualities};
+  }
+
+  // Builds a frame with the given content, inheriting the eventualities from
+  // the previous STEP of the branch, if any -> Step rule
+  Frame(const FrameID _id, const Bitset &_formulas, uint64_t _fingerprint,
+        const Bitset &_processed, const DynamicBitset &_requests,
+        Frame *chainPtr, uint64_t _number_of_eventualities)
+    : id(_id),
       chain(chainPtr),
-	    first(nullptr),
-	    prev(nullptr),
-      type(UNKNOWN)
+      first(nullptr),
+      prev(nullptr),
+      same(nullptr),
+      fingerprint(_fingerprint),
+      horizon(FrameID::max()),
+      number_of_eventualities(
+        static_cast<uint32_t>(_number_of_eventualities)),
+      stepped(false),
+      formulas(_formulas),
+      processed(_processed)
+  {
+    requests().assign(_requests);
+    fulfilled().reset();
+
+    if (chain) {
+      assert(chain->number_of_eventualities == number_of_eventualities);
+      std::uninitialized_copy(chain->eventualities().begin(),
+                              chain->eventualities().end(),
+                              eventualities().begin());
+    }
+    else {
+      for (Eventuality &ev : eventualities())
+        new (&ev) Eventuality();
+    }
+  }
+
+  Frame(const Frame &) = delete;
+  Frame &operator=(const Frame &) = delete;
+
+private:
+  size_t ev_blocks() const { return blocks_for(number_of_eventualities); }
+
+  uint64_t *words() { return reinterpret_cast<uint64_t *>(this + 1); }
+  const uint64_t *words() const
   {
-    to_process.set();
+    return reinterpret_cast<const uint64_t *>(this + 1);
   }
 };
 }
@@ -19,6 +19,7 @@
 #include "formula.hpp"
 #include "parser.hpp"
 #include "solver.hpp"
+#include "portfolio.hpp"
 #include "identifiable.hpp"
 #include "visitor.hpp"
 #include "pretty_printer.hpp"
@@ -30,6 +31,7 @@ namespace LTL {
 using detail::Parser;
 
 using detail::Solver;
+using detail::Portfolio;
 using detail::Model;
 using detail::ModelPtr;
 using detail::State;
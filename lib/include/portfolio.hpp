@@ -0,0 +1,113 @@
+/*
+Copyright (c) 2014, Matteo Bertello
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+* The names of its contributors may not be used to endorse or promote
+products derived from this software without specific prior written
+permission.
+*/
+
+#pragma once
+
+#include "formula.hpp"
+#include "solver.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace LTL
+{
+namespace detail
+{
+
+/*
+ * Races differently configured solvers on the same formula, each one on a
+ * thread of its own. The first definite answer wins, and the other solvers
+ * are cancelled. They are built one after the other beforehand, as they
+ * share the formula, and they log nothing while racing.
+ */
+class Portfolio
+{
+public:
+	struct Configuration
+	{
+		Solver::Strategy strategy;
+		FrameID maximum_depth = FrameID::max();
+	};
+
+	/*
+	 * The given number of configurations, starting from the default one and
+	 * going on with the other branching strategies and then random branchings
+	 * with restarts, each with its own seed
+	 */
+	static std::vector<Configuration> configurations(size_t count);
+
+	Portfolio(FormulaPtr formula, std::vector<Configuration> configurations);
+
+	Portfolio(const Portfolio&) = delete;
+	Portfolio& operator=(const Portfolio&) = delete;
+
+	/*
+	 * The deadline, the frames and the cancel flag are the same for every
+	 * solver, while the memory is split evenly among them
+	 */
+	inline const Solver::Budget& budget() const
+	{
+		return _budget;
+	}
+
+	inline void set_budget(const Solver::Budget& budget)
+	{
+		_budget = budget;
+	}
+
+	inline size_t size() const
+	{
+		return _solvers.size();
+	}
+
+	inline Solver& solver(size_t index)
+	{
+		return *_solvers[index];
+	}
+
+	inline const Configuration& configuration(size_t index) const
+	{
+		return _configurations[index];
+	}
+
+	/*
+	 * Runs the race, and gives the answer of the winner, if any. Once there
+	 * is one, its answer is kept, otherwise calling it again after raising the
+	 * budget goes on where every solver has stopped.
+	 */
+	Solver::Result solution();
+
+	/*
+	 * The solver giving the answer, left with the budget set here, from which
+	 * the models can be taken. It is nullptr when there is none.
+	 */
+	inline Solver* winner()
+	{
+		return _winner < _solvers.size() ? _solvers[_winner].get() : nullptr;
+	}
+
+private:
+	std::vector<Configuration> _configurations;
+	std::vector<std::unique_ptr<Solver>> _solvers;
+
+	Solver::Budget _budget;
+	std::atomic<bool> _cancel; // Set by the winner, or by the cancel flag given
+	size_t _winner;
+};
+
+}
+}
@@ -17,16 +17,18 @@ permission.
 
 #pragma once
 
-#include "boost/pool/pool_alloc.hpp"
+#include "bitset.hpp"
 #include "formula.hpp"
 #include "identifiable.hpp"
-#include "frame.hpp"
 #include "model.hpp"
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include <tuple>
 #include <limits>
-#include <stack>
+#include <memory>
 #include <queue>
 #include <unordered_map>
 #include <random>
@@ -36,7 +38,8 @@ namespace LTL
 namespace detail
 {
 
-using Stack = std::stack<Frame, std::deque<Frame, boost::fast_pool_allocator<Frame>>>;
+class Engine;
+class SatSolver;
 
 class Solver
 {
@@ -66,10 +69,119 @@ public:
 		uint64_t total_steps = 0;
 		uint64_t cross_by_contradiction = 0;
 		uint64_t cross_by_prune = 0;
+		uint64_t cross_by_depth = 0;
+		uint64_t propagations = 0;
+		uint64_t backjumps = 0;
+		uint64_t lookaheads = 0;
+		uint64_t lookahead_failures = 0;
+		uint64_t restarts = 0;
+		uint64_t cache_hits = 0;
+		uint64_t cache_misses = 0;
+		uint64_t cache_evictions = 0;
+		uint64_t clauses_learned = 0;
+		uint64_t clause_hits = 0;
+		uint64_t clause_deletions = 0;
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	/*
+	 * Limits on a search. When one is exceeded, solution() stops with an
+	 * UNDEFINED result in the PAUSED state, and calling it again after
+	 * raising the budget goes on from there. The frames are counted over
+	 * the whole life of the solver, as in Stats::total_frames, and the memory
+	 * is the one held by the search data structures.
+	 */
+	struct Budget
+	{
+		Clock::time_point deadline = Clock::time_point::max();
+		uint64_t frames = std::numeric_limits<uint64_t>::max();
+		size_t memory = std::numeric_limits<size_t>::max();
+		const std::atomic<bool> *cancel = nullptr; // Stops the search when set
+	};
+
+	/*
+	 * How the tableau expands a state. After the contradiction rule, the
+	 * rules are tried in the given order, which must have each of them once:
+	 * the conjunction and always rules expand every pending formula at once,
+	 * while the first choice rule with a pending formula branches on it and
+	 * the state is looked at again. Propositional formulas are left to a
+	 * SAT solver and do not follow it.
+	 */
+	struct Strategy
+	{
+		enum class Rule : uint8_t
+		{
+			CONJUNCTION = 0,
+			ALWAYS,
+			DISJUNCTION,
+			EVENTUALLY,
+			UNTIL,
+			RELEASE
+		};
+
+		/* Which pending formula of the choice rule to branch on */
+		enum class Branching : uint8_t
+		{
+			FIRST = 0,        // The first in the closure
+			MOST_CONSTRAINED, // The one with the fewest alternatives
+			MOST_SHARED,      // The one adding the most shared formulas
+			EVENTUALITIES,    // One fulfilling the oldest request, or the first
+			RANDOM            // Any of them
+		};
+
+		/* How many frames the search goes on before starting over */
+		enum class Restarts : uint8_t
+		{
+			NONE = 0,
+			LUBY,     // The interval times the Luby sequence: 1 1 2 1 1 2 4...
+			GEOMETRIC // The interval, growing by half at every restart
+		};
+
+		std::array<Rule, 6> rules = {{Rule::CONJUNCTION, Rule::ALWAYS,
+		                              Rule::DISJUNCTION, Rule::EVENTUALLY,
+		                              Rule::UNTIL, Rule::RELEASE}};
+		Branching branching = Branching::FIRST;
+
+		/* Postpone eventualities and take right disjuncts first */
+		bool second_alternative_first = false;
+
+		/*
+		 * Look at the closure of what each alternative adds before branching,
+		 * dropping the ones bound to a contradiction and taking the one adding
+		 * the most formulas first
+		 */
+		bool lookahead = false;
+
+		/*
+		 * The random branching is the same for the same seed, and changes at
+		 * every restart. Restarts only happen in a single-threaded search
+		 * which has not found a model yet, and what has been learned is kept.
+		 */
+		uint64_t seed = 0;
+		Restarts restarts = Restarts::NONE;
+		uint64_t restart_interval = 1000;
+	};
+
+	/*
+	 * Cube-and-conquer: the tableau is first explored down to the given number
+	 * of choices, and each branch still open there, a cube, is then searched
+	 * by one of the given number of worker processes forked from the Solver.
+	 * A model found by any of them stops the others. Each worker has the whole
+	 * budget for itself, except for the deadline. A depth of zero turns it
+	 * off, and zero workers means one per hardware thread. It replaces the
+	 * threads given to the constructor. Forking is only safe in a process
+	 * with a single thread, so with more the cubes are searched one after
+	 * the other by the Solver itself.
+	 */
+	struct Cubes
+	{
+		uint32_t depth = 0;
+		uint32_t workers = 0;
 	};
 
 	Solver() = delete;
-	~Solver() {}
+	~Solver();
 
 	Solver(const Solver&) = delete;
 	Solver(Solver&&) = delete;
@@ -77,7 +189,17 @@ public:
 	Solver& operator=(const Solver&) = delete;
 	Solver& operator=(Solver&&) = delete;
 
-	Solver(FormulaPtr formula, FrameID maximum_depth = FrameID::max());
+	Solver(FormulaPtr formula, FrameID maximum_depth = FrameID::max(),
+	       uint32_t number_of_threads = 1);
+
+	/*
+	 * Builds the closure of the formula together with a set of assumptions,
+	 * any subset of which can then be enabled by solve() without building
+	 * it again. solution() alone checks the formula with every assumption.
+	 */
+	Solver(FormulaPtr formula, std::vector<FormulaPtr> assumptions,
+	       FrameID maximum_depth = FrameID::max(),
+	       uint32_t number_of_threads = 1);
 
 	FormulaPtr inline Formula() const;
 
@@ -96,46 +218,142 @@ public:
 		return _maximum_depth;
 	}
 
+	inline uint32_t number_of_threads() const
+	{
+		return _number_of_threads;
+	}
+
 	inline const Stats& stats() const
 	{
 		return _stats;
 	}
 
+	inline const Budget& budget() const
+	{
+		return _budget;
+	}
+
+	inline void set_budget(const Budget& budget)
+	{
+		_budget = budget;
+	}
+
+	inline const Strategy& strategy() const
+	{
+		return _strategy;
+	}
+
+	/*
+	 * A strategy other than the default one, given before the first search,
+	 * leaves the formulas in the shape of GR(1) specifications to the
+	 * tableau as well
+	 */
+	void set_strategy(const Strategy& strategy);
+
+	inline const Cubes& cubes() const
+	{
+		return _cubes;
+	}
+
+	/* Only taken into account before the first search */
+	void set_cubes(const Cubes& cubes);
+
+	inline size_t number_of_assumptions() const
+	{
+		return _assumptions.size();
+	}
+
 	Result solution();
 	ModelPtr model();
 
+	/*
+	 * Gives the models of the formula one at a time, each differing from the
+	 * ones given before in the atoms true at some state. They are in their
+	 * shortest form, with the loop unrolled as little as possible. Returns
+	 * nullptr when there are no more, or when the budget runs out, in which
+	 * case the state is PAUSED and the next call goes on from there.
+	 */
+	ModelPtr next_model();
+
+	/*
+	 * Starts a new search for a model with as few states as possible. The
+	 * depth of the tableau is bounded by a doubling limit, and tightened below
+	 * the size of every model found. If the state ends up DONE the model is
+	 * the shortest one of the tableau, otherwise the budget has run out and it
+	 * is only the shortest found so far, if any. It comes in the shortest
+	 * form, as with next_model().
+	 */
+	ModelPtr shortest_model();
+
+	/* The depth the tableau needs for a model, as proven by shortest_model() */
+	inline FrameID depth_lower_bound() const
+	{
+		return _depth_lower_bound;
+	}
+
+	/*
+	 * Starts a new search for the formula together with the given assumptions,
+	 * by their index in the constructor arguments. The closure and what has
+	 * been learned about it are kept, as are the statistics.
+	 */
+	Result solve(const std::vector<size_t>& assumptions);
+
 private:
 	FormulaPtr _formula;
+	std::vector<FormulaPtr> _assumptions;
 
 	FrameID _maximum_depth;
 
+	/* Workers of the search, one meaning the sequential tableau */
+	uint32_t _number_of_threads;
+
 	State _state;
 	Result _result;
 
+	Budget _budget;
+	Strategy _strategy;
+	Cubes _cubes;
+
+	/* Some model has been found, even if the search is now exhausted */
+	bool _satisfiable;
+
+	/* Stats::cross_by_depth when the current search started */
+	uint64_t _cross_by_depth_before;
+
+	/* The model the search stopped on has been given by next_model() */
+	bool _model_reported;
+
+	/* Proven by shortest_model() */
+	FrameID _depth_lower_bound;
+
+	/* Models given by next_model() so far, by their hash */
+	std::unordered_multimap<uint64_t, ModelPtr> _reported_models;
+
 	struct
 	{
-		Bitset atom;
-		Bitset negation;
-		Bitset tomorrow;
-    Bitset yesterday;
-		Bitset always;
-		Bitset eventually;
-		Bitset conjunction;
-		Bitset disjunction;
-		Bitset until;
-    Bitset release;
-    Bitset since;
-    Bitset triggered;
-    Bitset past;
-    Bitset historically;
-		Bitset eventualities;
-
-		/* This is used to do computations avoiding allocations */
-		Bitset temporary;
+		DynamicBitset atom;
+		DynamicBitset negation;
+		DynamicBitset tomorrow;
+    DynamicBitset yesterday;
+		DynamicBitset always;
+		DynamicBitset eventually;
+		DynamicBitset conjunction;
+		DynamicBitset disjunction;
+		DynamicBitset until;
+    DynamicBitset release;
+    DynamicBitset since;
+    DynamicBitset triggered;
+    DynamicBitset past;
+    DynamicBitset historically;
+		DynamicBitset eventualities;
 	} _bitset;
 
 	std::vector<FormulaID> _lhs;
 	std::vector<FormulaID> _rhs;
+
+	/* Formulas added by the conjunction and always rules alone when expanding each formula */
+	std::vector<DynamicBitset> _alpha_closure;
+
 	std::unordered_map<FormulaID, std::string> _atom_set;
 
 	std::vector<FormulaID> _fw_eventualities_lut;
@@ -143,10 +361,15 @@ private:
 
 	size_t _number_of_formulas;
 	FormulaID _start_index;
-	FrameID _loop_state;
+
+	/* Position of every assumption in the closure, max() if True or False */
+	std::vector<FormulaID> _assumption_index;
+
+	/* Formulas of the initial state of the search */
+	DynamicBitset _initial;
+	std::vector<size_t> _enabled_assumptions;
 
 	std::vector<FormulaPtr> _subformulas;
-	Stack _stack;
 
 	Stats _stats;
 
@@ -154,34 +377,33 @@ private:
 	bool _has_until;
   bool _has_release;
 
-	void _initialize();
-	void _add_formula_for_position(const FormulaPtr& formula, FormulaID position, FormulaID lhs, FormulaID rhs);
+	/* The actual search, specialized on the size of the closure */
+	std::unique_ptr<Engine> _engine;
 
-	inline bool _check_contradiction_rule();
-	inline bool _apply_conjunction_rule();
-	inline bool _apply_always_rule();
-	inline bool _apply_disjunction_rule();
-	inline bool _apply_eventually_rule();
-	inline bool _apply_until_rule();
-  inline bool _apply_release_rule();
+	template <typename Bitset>
+	friend class Tableau;
 
-	inline void _rollback_to_latest_choice();
-	inline void _update_eventualities_satisfaction();
-	inline void _update_history();
+	template <typename Bitset>
+	friend class ParallelTableau;
 
-	inline std::pair<bool, FrameID> _check_loop_rule() const;
-	inline bool _check_prune0_rule() const;
-	inline bool _check_prune_rule() const;
-	inline bool _check_my_prune() const;
+	template <typename Bitset>
+	friend class CubeTableau;
 
-	void _print_stats() const;
+	friend class PropositionalEngine;
+	friend class FairCycleEngine;
 
-	void __dump_frame(Frame const*frame) const;
-	void __dump_frame_formulas(Frame const*frame) const;
-	void __dump_requested_eventualities(Frame const*frame) const;
-	void __dump_satisfied_eventualities(Frame const*frame) const;
-	void __dump_current_branch() const;
+	void _initialize();
+	void _add_formula_for_position(const FormulaPtr& formula, FormulaID position, FormulaID lhs, FormulaID rhs);
+	void _build_alpha_closure();
+	bool _is_propositional() const;
+	bool _is_gr1() const;
+	void _encode_closure(SatSolver& sat) const;
+	void _select_assumptions(const std::vector<size_t>& assumptions);
+	void _make_engine();
+	std::unique_ptr<Engine> _make_tableau();
+	bool _uses_fair_cycle_engine() const;
 
+	void _print_stats() const;
 };
 
 }
@@ -19,10 +19,10 @@ permission.
 
 #include <type_traits>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 #include <cassert>
-#include <limits>
-#include <tuple>
+#include <memory>
 #include <utility>
 #include <iterator>
 
@@ -31,103 +31,141 @@ namespace LTL
 namespace detail
 {
 
-static constexpr size_t STARTING_SIZE = 1000;
+static constexpr size_t CACHE_LINE_SIZE = 64;
 
-template<typename T, size_t BlockN>
+/*
+ * Stack of records allocated in blocks of BlockN elements, which are never
+ * moved nor freed until the stack is destroyed. Pointers to the elements stay
+ * valid as long as the elements themselves are on the stack, and popping an
+ * element only destroys it and moves the top back.
+ *
+ * The size of each record is given at construction time and can be larger
+ * than sizeof(T), leaving room for a trailing array whose length is only
+ * known at runtime. Every record is aligned to a cache line.
+ */
+template<typename T, size_t BlockN = 256>
 class stack
 {
-	using indices_t = std::pair<uint64_t, uint64_t>;
-	template<typename Ptr> class iterator_t;
-	friend class iterator_t<T*>;
-	friend class iterator_t<const T*>;
+	template<typename Ptr, typename Stack> class iterator_t;
 
 public:
-	using iterator = iterator_t<T*>;
-	using const_iterator = iterator_t<const T*>;
+	using iterator = iterator_t<T*, stack>;
+	using const_iterator = iterator_t<const T*, const stack>;
 	using reverse_iterator = std::reverse_iterator<iterator>;
 	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-	stack() : _blocks(STARTING_SIZE), _top(EMPTY_IDX) {}
-	~stack() = default;
+	explicit stack(size_t element_size = sizeof(T))
+		: _stride(round_up(element_size)), _blocks(), _size(0)
+	{
+		assert(element_size >= sizeof(T));
+	}
 
-	stack(const stack&) = default;
-	stack(stack&&) = default;
+	~stack()
+	{
+		clear();
+		for (Block &block : _blocks)
+			delete[] block.memory;
+	}
 
-	stack& operator=(const stack&) = default;
-	stack& operator=(stack&&) = default;
+	stack(const stack&) = delete;
+	stack& operator=(const stack&) = delete;
+
+	stack(stack&& other)
+		: _stride(other._stride), _blocks(std::move(other._blocks)),
+		  _size(other._size)
+	{
+		other._blocks.clear();
+		other._size = 0;
+	}
+
+	stack& operator=(stack&& other)
+	{
+		swap(other);
+		return *this;
+	}
 
 	T& top()
 	{
-		// Scott Meyers approves!
-		return const_cast<T&>(static_cast<const stack*>(this)->top());
+		assert(!empty());
+		return (*this)[_size - 1];
 	}
 
 	const T& top() const
 	{
-		uint64_t block_idx = 0;
-		uint64_t elem_idx = 0;
-		std::tie(block_idx, elem_idx) = indices();
+		assert(!empty());
+		return (*this)[_size - 1];
+	}
 
-		assert(elem_idx < BlockN);
-		assert(block_idx < _blocks.size());
+	T& operator[](size_t pos)
+	{
+		assert(pos < _size);
+		return *reinterpret_cast<T*>(address(pos));
+	}
 
-		return (*_blocks[block_idx])[elem_idx];
+	const T& operator[](size_t pos) const
+	{
+		assert(pos < _size);
+		return *reinterpret_cast<const T*>(address(pos));
 	}
 
 	bool empty() const
 	{
-		return _top == EMPTY_IDX;
+		return _size == 0;
 	}
 
 	size_t size() const
 	{
-		return static_cast<size_t>(_top + 1);
+		return _size;
 	}
 
-	void push(const T& value)
+	// Size in bytes of every record, padding included
+	size_t stride() const
 	{
-		uint64_t block_idx = 0;
-		uint64_t elem_idx = 0;
-		std::tie(block_idx, elem_idx) = increase_size();
-
-		_blocks[block_idx]->insert(elem_idx, value);
+		return _stride;
 	}
 
-	void push(T&& value)
+	// Memory currently held by the stack, including unused blocks
+	size_t allocated_bytes() const
 	{
-		uint64_t block_idx = 0;
-		uint64_t elem_idx = 0;
-		std::tie(block_idx, elem_idx) = increase_size();
-		
-		_blocks[block_idx]->insert(elem_idx, value);
+		return _blocks.size() * (BlockN * _stride + CACHE_LINE_SIZE);
 	}
 
 	template<typename... Args>
-	void emplace(Args&&... args)
+	T& emplace(Args&&... args)
 	{
-		uint64_t block_idx = 0;
-		uint64_t elem_idx = 0;
-		std::tie(block_idx, elem_idx) = increase_size();
+		if (_size == _blocks.size() * BlockN)
+			_blocks.push_back(allocate_block());
+
+		T* elem = new(address(_size)) T(std::forward<Args>(args)...);
+		++_size;
 
-		_blocks[block_idx]->emplace(elem_idx, std::forward<Args>(args)...);
+		return *elem;
+	}
+
+	void push(const T& value)
+	{
+		emplace(value);
 	}
 
 	void pop()
 	{
-		assert(_top != EMPTY_IDX);
+		assert(!empty());
 
-		uint64_t block_idx = 0;
-		uint64_t elem_idx = 0;
-		std::tie(block_idx, elem_idx) = indices();
+		--_size;
+		reinterpret_cast<T*>(address(_size))->~T();
+	}
 
-		_block[block_idx]->erase(elem_idx);
-		--_top;
+	void clear()
+	{
+		while (!empty())
+			pop();
 	}
 
 	void swap(stack& other)
 	{
+		std::swap(_stride, other._stride);
 		std::swap(_blocks, other._blocks);
-		std::swap(_top, other._top);
+		std::swap(_size, other._size);
 	}
 
 	iterator begin()
@@ -137,173 +175,150 @@ public:
 
 	iterator end()
 	{
-		return iterator(*this, _top + 1);
+		return iterator(*this, _size);
 	}
 
-	const_iterator cbegin()
+	const_iterator begin() const
 	{
 		return const_iterator(*this, 0);
 	}
 
-	const_iterator cend()
+	const_iterator end() const
 	{
-		return const_iterator(*this, _top + 1);
+		return const_iterator(*this, _size);
+	}
+
+	const_iterator cbegin() const
+	{
+		return begin();
+	}
+
+	const_iterator cend() const
+	{
+		return end();
 	}
 
 	reverse_iterator rbegin()
 	{
-		return std::make_reverse_iterator(end());
+		return reverse_iterator(end());
 	}
 
 	reverse_iterator rend()
 	{
-		return std::make_reverse_iterator(begin());
+		return reverse_iterator(begin());
 	}
 
-	const_reverse_iterator crbegin()
+	const_reverse_iterator crbegin() const
 	{
-		return std::make_reverse_iterator(cend());
+		return const_reverse_iterator(cend());
 	}
 
-	const_reverse_iterator crend()
+	const_reverse_iterator crend() const
 	{
-		return std::make_reverse_iterator(cbegin());
+		return const_reverse_iterator(cbegin());
 	}
 
-	template<typename Ptr>
+private:
+	template<typename Ptr, typename Stack>
 	class iterator_t
 	{
 		friend class stack;
 
-		using pointed_type = typename std::remove_pointer<Ptr>::type;
-
 	public:
-		iterator_t() = delete;
-		~iterator_t() = default;
-
-		// TODO: missing constructor, assignment operators, and full RandomAccessIterator interface
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = typename std::remove_const<T>::type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = Ptr;
+		using reference = typename std::remove_pointer<Ptr>::type&;
 
-		Ptr operator*()
+		reference operator*() const
 		{
-			uint64_t block_idx = 0;
-			uint64_t elem_idx = 0;
-			std::tie(block_idx, elem_idx) = _stack.indices(elem);
-
-			return &(_stack._blocks[block_idx][elem_idx]);
+			return (*_stack)[_elem];
 		}
 
-		pointed_type& operator[](size_t n)
+		pointer operator->() const
 		{
-			assert(elem + n < _stack._top);
-
-			uint64_t block_idx = 0;
-			uint64_t elem_idx = 0;
-			std::tie(block_idx, elem_idx) = _stack.indices(elem + n);
-
-			return _stack[block_idx][elem_idx];
+			return &(*_stack)[_elem];
 		}
 
-	private:
-		iterator_t(stack& s, uint64_t elem) : _stack(s), _elem(elem) {}
-
-		stack& _stack;
-		uint64_t elem;
-	};
-
-private:
-	class Block
-	{
-	public:
-		Block() = default;
-		~Block() = default;
-
-		Block(const Block&) = delete;
-		Block(Block&&) = delete;
-
-		Block& operator=(const Block&) = delete;
-		Block& operator=(Block&&) = delete;
-
-		void insert(size_t pos, const T& elem)
+		iterator_t& operator++()
 		{
-			assert(pos < BlockN);
-			new(_data + pos) T(elem);
+			++_elem;
+			return *this;
 		}
 
-		void insert(size_t pos, T&& elem)
+		iterator_t operator++(int)
 		{
-			assert(pos < BlockN);
-			new(_data + pos) T(elem);
+			iterator_t tmp = *this;
+			++_elem;
+			return tmp;
 		}
 
-		template<typename ...Args>
-		void emplace(size_t pos, Args&&... args)
+		iterator_t& operator--()
 		{
-			assert(pos < BlockN);
-			new(_data + pos) T(std::forward<Args>(args)...);
+			--_elem;
+			return *this;
 		}
 
-		void erase(size_t pos)
+		iterator_t operator--(int)
 		{
-			assert(pos < BlockN);
-			reinterpret_cast<const T*>(_data + pos)->~T();
+			iterator_t tmp = *this;
+			--_elem;
+			return tmp;
 		}
 
-		const T& operator[](size_t pos) const
+		friend bool operator==(const iterator_t& a, const iterator_t& b)
 		{
-			assert(pos < BlockN);
-			return *reinterpret_cast<const T*>(_data + pos);
+			return a._stack == b._stack && a._elem == b._elem;
 		}
 
-		T& operator[](size_t pos)
+		friend bool operator!=(const iterator_t& a, const iterator_t& b)
 		{
-			assert(pos < BlockN);
-			return *reinterpret_cast<T*>(_data + pos);
+			return !(a == b);
 		}
 
 	private:
-		typename std::aligned_storage<sizeof(T), alignof(T)>::type _data[BlockN];
+		iterator_t(Stack& s, size_t elem) : _stack(&s), _elem(elem) {}
+
+		Stack* _stack;
+		size_t _elem;
 	};
-	
-	std::vector<Block*> _blocks;
-	uint64_t _top;
-	
-	indices_t indices() const
+
+	struct Block
 	{
-		return indices(_top);
-	}
+		char* memory;
+		char* data;
+	};
+
+	size_t _stride;
+	std::vector<Block> _blocks;
+	size_t _size;
 
-	indices_t indices(uint64_t elem) const
+	static size_t round_up(size_t size)
 	{
-		return { elem / BlockN, elem % BlockN };
+		return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
 	}
 
-	indices_t increase_size()
+	Block allocate_block() const
 	{
-		++_top;
-		assert(_top != std::numeric_limits<uint64_t>::max());
+		size_t bytes = BlockN * _stride + CACHE_LINE_SIZE;
+		char* memory = new char[bytes];
 
-		uint64_t block_idx = 0;
-		uint64_t elem_idx = 0;
-		std::tie(block_idx, elem_idx) = indices();
+		void* data = memory;
+		std::align(CACHE_LINE_SIZE, BlockN * _stride, data, bytes);
+		assert(data != nullptr);
 
-		if (block_idx == _blocks.size())
-		{
-			_blocks.push_back(new Block());
-			assert(_block_idx == _blocks.size() + 1);
-		}
-
-		assert(elem_idx < BlockN);
-		assert(block_idx < _blocks.size());
-
-		return { block_idx, elem_idx };
+		return { memory, static_cast<char*>(data) };
 	}
 
-	static constexpr uint64_t EMPTY_IDX = std::numeric_limits<uint64_t>::max();
+	char* address(size_t pos) const
+	{
+		return _blocks[pos / BlockN].data + (pos % BlockN) * _stride;
+	}
 };
 
-template<typename T, uint64_t BlockN>
-void swap(stack<T, BlockN>& lhs,
-		  stack<T, BlockN>& rhs)
+template<typename T, size_t BlockN>
+void swap(stack<T, BlockN>& lhs, stack<T, BlockN>& rhs)
 {
 	lhs.swap(rhs);
 }
@@ -0,0 +1,543 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include "engine.hpp"
+#include "format.hpp"
+#include "tableau.hpp"
+#include "work_queue.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace LTL {
+namespace detail {
+
+/*
+ * Cube-and-conquer over forked worker processes.
+ *
+ * A master Tableau first explores the tableau down to the number of choices
+ * given by Solver::Cubes, and every branch still open there becomes a cube:
+ * the alternatives taken at its choices, as the tasks of the WorkQueue. The
+ * workers are then forked from the master, so that they share its closure
+ * and what it has learned, and each one searches a cube at a time, replaying
+ * it with Tableau::start(). The cubes are sent over a local socket, one at a
+ * time to whoever is idle, and the answers come back the same way with the
+ * statistics of the worker and, when it has found one, its model. The first
+ * model found kills the other workers.
+ *
+ * Running out of budget stops every worker, and their cubes are searched
+ * again from the start by the next run. A worker dying on a cube only loses
+ * that one, which is left to the next run as well, so that the answer is
+ * UNDEFINED rather than wrong. When no worker can be forked at all, or the
+ * process has other threads, which would leave the locks they hold taken
+ * forever in the workers, the master searches the cubes by itself.
+ *
+ * Looking for the next model after one found by a worker, the cube it comes
+ * from is searched again by the master, before going on with the others.
+ * The worker's model is found there again, and is then skipped.
+ */
+template <typename Bitset>
+class CubeTableau : public Engine {
+  using Master = Tableau<Bitset>;
+  using Cube = WorkQueue::Path;
+
+public:
+  explicit CubeTableau(Solver &solver);
+  virtual ~CubeTableau() override {}
+
+  virtual Outcome solution() override;
+  virtual ModelPtr model() const override;
+  virtual void reset(const DynamicBitset &initial) override;
+
+private:
+  enum class Phase : uint8_t {
+    SPLITTING,  // The master is making the cubes
+    CONQUERING, // The workers are searching them
+    LOCAL       // The master is searching a cube by itself
+  };
+
+  struct Worker
+  {
+    pid_t pid = -1;
+    int socket = -1; // The master's end
+    bool busy = false;
+    Cube cube;
+    Solver::Stats stats; // As of its latest answer
+  };
+
+  /* How often the master looks at the cancel flag while the workers run */
+  static constexpr int POLL_INTERVAL = 10; // Milliseconds
+
+  Solver &_solver;
+  Master _master;
+  Phase _phase;
+
+  std::deque<Cube> _pending; // Not searched yet
+  Cube _local;               // Searched by the master
+  bool _local_started;
+  ModelPtr _model;  // Found by a worker
+  ModelPtr _repeat; // The same, to skip in the search of its cube by the master
+
+  Outcome _conquer();
+  bool _spawn(std::vector<Worker> &workers, size_t index);
+  void _search_locally();
+  static bool _single_threaded();
+  static void _serve(Master &master, const Solver::Stats &stats, int socket);
+  static void _stop(Worker &worker);
+
+  static bool _write(int fd, const void *data, size_t size);
+  static bool _read(int fd, void *data, size_t size);
+  static bool _write_model(int fd, const Model &model);
+  static ModelPtr _read_model(int fd);
+};
+
+template <typename Bitset>
+CubeTableau<Bitset>::CubeTableau(Solver &solver)
+  : _solver(solver),
+    _master(solver),
+    _phase(Phase::SPLITTING),
+    _pending(),
+    _local(),
+    _local_started(false),
+    _model(),
+    _repeat()
+{
+}
+
+template <typename Bitset>
+Engine::Outcome CubeTableau<Bitset>::solution()
+{
+  _model = nullptr;
+
+  while (true) {
+    Outcome outcome = Outcome::EXHAUSTED;
+
+    switch (_phase) {
+      case Phase::SPLITTING:
+        outcome = _master.split(_solver._cubes.depth, _pending);
+        if (outcome != Outcome::EXHAUSTED)
+          return outcome;
+
+        format::debug("Split the tableau into {} cubes", _pending.size());
+        _phase = Phase::CONQUERING;
+        break;
+
+      case Phase::CONQUERING:
+        if (_pending.empty())
+          return Outcome::EXHAUSTED;
+
+        outcome = _conquer();
+        if (outcome != Outcome::EXHAUSTED)
+          return outcome;
+        break;
+
+      case Phase::LOCAL:
+        if (_local_started)
+          outcome = _master.search();
+        else {
+          _local_started = true;
+          outcome = _master.start(_local);
+        }
+
+        if (outcome == Outcome::SATISFIABLE && _repeat) {
+          ModelPtr model = _master.model();
+          if (model->loop_state == _repeat->loop_state &&
+              model->states == _repeat->states) {
+            format::debug("Skipping the model of the worker, found again");
+            _repeat = nullptr;
+            continue;
+          }
+        }
+        if (outcome != Outcome::EXHAUSTED)
+          return outcome;
+
+        _phase = Phase::CONQUERING;
+        break;
+    }
+  }
+}
+
+template <typename Bitset>
+ModelPtr CubeTableau<Bitset>::model() const
+{
+  return _model ? _model : _master.model();
+}
+
+template <typename Bitset>
+void CubeTableau<Bitset>::reset(const DynamicBitset &initial)
+{
+  _master.reset(initial);
+  _phase = Phase::SPLITTING;
+  _pending.clear();
+  _local.clear();
+  _model = nullptr;
+  _repeat = nullptr;
+}
+
+// Hands the cubes over to the workers until one of them finds a model, they
+// are all done, or the search is stopped. The cubes being searched when it
+// stops go back to the queue, as do the ones of the workers which have died.
+// Without any worker, the next cube is left to the master instead.
+template <typename Bitset>
+Engine::Outcome CubeTableau<Bitset>::_conquer()
+{
+  uint32_t number_of_workers = _solver._cubes.workers;
+  if (number_of_workers == 0)
+    number_of_workers = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<Worker> workers(
+    std::min(size_t(number_of_workers), _pending.size()));
+  if (!_single_threaded())
+    workers.clear();
+  for (size_t i = 0; i < workers.size(); ++i)
+    if (!_spawn(workers, i))
+      break;
+
+  if (workers.empty() || workers[0].pid < 0) {
+    format::debug("Searching a cube without workers");
+    _search_locally();
+    return Outcome::EXHAUSTED;
+  }
+
+  format::debug("Searching {} cubes with {} workers", _pending.size(),
+                workers.size());
+
+  std::deque<Cube> lost;
+  bool interrupted = false;
+  bool found = false;
+
+  auto give = [&](Worker &worker) {
+    uint64_t size = _pending.front().size();
+    std::vector<uint8_t> alternatives(_pending.front().begin(),
+                                      _pending.front().end());
+
+    if (!_write(worker.socket, &size, sizeof(size)) ||
+        !_write(worker.socket, alternatives.data(), alternatives.size())) {
+      _stop(worker);
+      return;
+    }
+
+    worker.cube = std::move(_pending.front());
+    worker.busy = true;
+    _pending.pop_front();
+  };
+
+  for (Worker &worker : workers)
+    if (worker.pid > 0 && !_pending.empty())
+      give(worker);
+
+  std::vector<pollfd> fds;
+  std::vector<Worker *> polled;
+  while (!found && !interrupted) {
+    fds.clear();
+    polled.clear();
+    for (Worker &worker : workers) {
+      if (worker.busy) {
+        fds.push_back({worker.socket, POLLIN, 0});
+        polled.push_back(&worker);
+      }
+    }
+
+    if (fds.empty())
+      break;
+
+    if (poll(fds.data(), fds.size(), POLL_INTERVAL) < 0 && errno != EINTR)
+      break;
+
+    if (_solver._budget.cancel && *_solver._budget.cancel)
+      interrupted = true;
+
+    for (size_t i = 0; i < fds.size() && !found; ++i) {
+      if (!fds[i].revents)
+        continue;
+
+      Worker &worker = *polled[i];
+      uint8_t answer = 0;
+      Solver::Stats stats;
+      ModelPtr model;
+      bool received = _read(worker.socket, &answer, sizeof(answer)) &&
+                      _read(worker.socket, &stats, sizeof(stats));
+
+      Outcome outcome = static_cast<Outcome>(answer);
+      if (received && outcome == Outcome::SATISFIABLE)
+        received = (model = _read_model(worker.socket)) != nullptr;
+
+      worker.busy = false;
+      if (!received) {
+        format::debug("A worker has died, its cube is left for later");
+        lost.push_back(std::move(worker.cube));
+        _stop(worker);
+        continue;
+      }
+
+      add_stats(_solver._stats, stats, worker.stats);
+      worker.stats = stats;
+
+      switch (outcome) {
+        case Outcome::SATISFIABLE:
+          _model = model;
+          _repeat = model;
+          _pending.push_front(std::move(worker.cube));
+          found = true;
+          break;
+        case Outcome::EXHAUSTED:
+          if (!_pending.empty())
+            give(worker);
+          break;
+        case Outcome::INTERRUPTED:
+        case Outcome::CANCELLED:
+          _pending.push_back(std::move(worker.cube));
+          interrupted = true;
+          break;
+      }
+    }
+  }
+
+  for (Worker &worker : workers) {
+    if (worker.busy)
+      _pending.push_back(std::move(worker.cube));
+    _stop(worker);
+  }
+
+  _pending.insert(_pending.end(), lost.begin(), lost.end());
+
+  if (found) {
+    _search_locally();
+    return Outcome::SATISFIABLE;
+  }
+
+  if (interrupted || !_pending.empty())
+    return Outcome::INTERRUPTED;
+
+  return Outcome::EXHAUSTED;
+}
+
+// The worker gets a copy of the master's end of the sockets of the ones
+// forked before it, which it closes, so that they see the master going away
+template <typename Bitset>
+bool CubeTableau<Bitset>::_spawn(std::vector<Worker> &workers, size_t index)
+{
+  Worker &worker = workers[index];
+  worker.stats = _solver._stats;
+
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+    return false;
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(sockets[0]);
+    for (size_t i = 0; i < index; ++i)
+      if (workers[i].socket >= 0)
+        close(workers[i].socket);
+
+    _serve(_master, _solver._stats, sockets[1]);
+    _exit(0);
+  }
+
+  close(sockets[1]);
+  if (pid < 0) {
+    close(sockets[0]);
+    return false;
+  }
+
+  worker.pid = pid;
+  worker.socket = sockets[0];
+
+  return true;
+}
+
+// The next cube is searched by the master, from the start
+template <typename Bitset>
+void CubeTableau<Bitset>::_search_locally()
+{
+  _local = std::move(_pending.front());
+  _pending.pop_front();
+  _local_started = false;
+  _phase = Phase::LOCAL;
+}
+
+// Counting the threads is left to Linux, elsewhere the process is assumed to
+// have only one
+template <typename Bitset>
+bool CubeTableau<Bitset>::_single_threaded()
+{
+  DIR *tasks = opendir("/proc/self/task");
+  if (!tasks)
+    return true;
+
+  size_t threads = 0;
+  while (dirent *entry = readdir(tasks))
+    if (entry->d_name[0] != '.')
+      ++threads;
+  closedir(tasks);
+
+  return threads <= 1;
+}
+
+// The loop of a worker process, until the master goes away or kills it
+template <typename Bitset>
+void CubeTableau<Bitset>::_serve(Master &master, const Solver::Stats &stats,
+                                 int socket)
+{
+  format::set_verbosity_level(format::Silent);
+
+  uint64_t size;
+  while (_read(socket, &size, sizeof(size))) {
+    std::vector<uint8_t> alternatives(size);
+    if (!_read(socket, alternatives.data(), alternatives.size()))
+      return;
+
+    Outcome outcome =
+      master.start(Cube(alternatives.begin(), alternatives.end()));
+
+    uint8_t answer = static_cast<uint8_t>(outcome);
+    if (!_write(socket, &answer, sizeof(answer)) ||
+        !_write(socket, &stats, sizeof(stats)))
+      return;
+
+    if (outcome == Outcome::SATISFIABLE &&
+        !_write_model(socket, *master.model()))
+      return;
+  }
+}
+
+template <typename Bitset>
+void CubeTableau<Bitset>::_stop(Worker &worker)
+{
+  if (worker.pid <= 0)
+    return;
+
+  kill(worker.pid, SIGKILL);
+  close(worker.socket);
+  while (waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR)
+    continue;
+
+  worker.pid = -1;
+  worker.socket = -1;
+}
+
+template <typename Bitset>
+bool CubeTableau<Bitset>::_write(int fd, const void *data, size_t size)
+{
+  const char *bytes = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t written = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return false;
+    bytes += written;
+    size -= size_t(written);
+  }
+
+  return true;
+}
+
+template <typename Bitset>
+bool CubeTableau<Bitset>::_read(int fd, void *data, size_t size)
+{
+  char *bytes = static_cast<char *>(data);
+  while (size > 0) {
+    ssize_t done = read(fd, bytes, size);
+    if (done < 0 && errno == EINTR)
+      continue;
+    if (done <= 0)
+      return false;
+    bytes += done;
+    size -= size_t(done);
+  }
+
+  return true;
+}
+
+// The loop state, then every state as its number of literals followed by
+// their sign, and the length and name of their atom
+template <typename Bitset>
+bool CubeTableau<Bitset>::_write_model(int fd, const Model &model)
+{
+  uint64_t header[2] = {model.loop_state, model.states.size()};
+  if (!_write(fd, header, sizeof(header)))
+    return false;
+
+  for (const State &state : model.states) {
+    uint64_t literals = state.size();
+    if (!_write(fd, &literals, sizeof(literals)))
+      return false;
+
+    for (const Literal &literal : state) {
+      std::string atom = literal.atom();
+      uint8_t positive = literal.positive();
+      uint64_t length = atom.size();
+      if (!_write(fd, &positive, sizeof(positive)) ||
+          !_write(fd, &length, sizeof(length)) ||
+          !_write(fd, atom.data(), atom.size()))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+template <typename Bitset>
+ModelPtr CubeTableau<Bitset>::_read_model(int fd)
+{
+  ModelPtr model = std::make_shared<Model>();
+
+  uint64_t header[2];
+  if (!_read(fd, header, sizeof(header)))
+    return nullptr;
+  model->loop_state = header[0];
+  model->states.resize(header[1]);
+
+  for (State &state : model->states) {
+    uint64_t literals;
+    if (!_read(fd, &literals, sizeof(literals)))
+      return nullptr;
+
+    for (uint64_t i = 0; i < literals; ++i) {
+      uint8_t positive;
+      uint64_t length;
+      if (!_read(fd, &positive, sizeof(positive)) ||
+          !_read(fd, &length, sizeof(length)))
+        return nullptr;
+
+      std::string atom(length, '\0');
+      if (!_read(fd, &atom[0], length))
+        return nullptr;
+      state.insert(Literal(atom, positive != 0));
+    }
+  }
+
+  return model;
+}
+}
+}
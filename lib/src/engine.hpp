@@ -0,0 +1,86 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include "solver.hpp"
+
+#include <algorithm>
+
+namespace LTL {
+namespace detail {
+
+/*
+ * Interface between the Solver front end, which owns the closure of the
+ * formula, and the search procedure working on it. Engines read the closure
+ * tables and the budget directly from the Solver and report back through its
+ * statistics, while the Solver turns the outcome of each run into its state
+ * and result.
+ */
+class Engine {
+public:
+  enum class Outcome : uint8_t {
+    SATISFIABLE, // Found a model, the next run looks for another one
+    EXHAUSTED,   // Nothing left to explore
+    INTERRUPTED, // Out of budget, the next run goes on from there
+    CANCELLED    // Stopped by another worker of a parallel search
+  };
+
+  Engine() = default;
+  virtual ~Engine();
+
+  Engine(const Engine &) = delete;
+  Engine &operator=(const Engine &) = delete;
+
+  // Called only in the INITIALIZED and PAUSED states. Never CANCELLED.
+  virtual Outcome solution() = 0;
+
+  // Called only in the PAUSED state after a SATISFIABLE answer
+  virtual ModelPtr model() const = 0;
+
+  // Drops the current search and starts the next one from the given formulas
+  virtual void reset(const DynamicBitset &initial) = 0;
+};
+
+// Adds what a worker has done from the given statistics of its own to the
+// current ones
+inline void add_stats(Solver::Stats &total, const Solver::Stats &now,
+                      const Solver::Stats &before)
+{
+  total.maximum_frames = std::max(total.maximum_frames, now.maximum_frames);
+  total.total_frames += now.total_frames - before.total_frames;
+  total.maximum_model_size =
+    std::max(total.maximum_model_size, now.maximum_model_size);
+  total.total_steps += now.total_steps - before.total_steps;
+  total.cross_by_contradiction +=
+    now.cross_by_contradiction - before.cross_by_contradiction;
+  total.cross_by_prune += now.cross_by_prune - before.cross_by_prune;
+  total.cross_by_depth += now.cross_by_depth - before.cross_by_depth;
+  total.propagations += now.propagations - before.propagations;
+  total.backjumps += now.backjumps - before.backjumps;
+  total.lookaheads += now.lookaheads - before.lookaheads;
+  total.lookahead_failures +=
+    now.lookahead_failures - before.lookahead_failures;
+  total.restarts += now.restarts - before.restarts;
+  total.cache_hits += now.cache_hits - before.cache_hits;
+  total.cache_misses += now.cache_misses - before.cache_misses;
+  total.cache_evictions += now.cache_evictions - before.cache_evictions;
+  total.clauses_learned += now.clauses_learned - before.clauses_learned;
+  total.clause_hits += now.clause_hits - before.clause_hits;
+  total.clause_deletions += now.clause_deletions - before.clause_deletions;
+}
+}
+}
@@ -0,0 +1,687 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include "engine.hpp"
+#include "sat_solver.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace LTL {
+namespace detail {
+
+/*
+ * Engine for the conjunctions in the shape of GR(1) specifications, as told
+ * apart by the Solver. Besides local formulas, made of atoms, boolean
+ * connectives and tomorrow formulas, they only have always formulas of local
+ * ones, the invariants, eventually formulas of local ones under an always
+ * formula, the fairness conditions, and eventually always formulas of local
+ * ones, the persistent formulas. Eventually formulas of local ones can also
+ * be found among the disjuncts of any of them, the responses.
+ *
+ * No temporal formula has then to be carried from a state to the next but
+ * the local ones required by tomorrow formulas and the responses still
+ * pending, and the states of the search are just these sets, together with
+ * whether the persistent formulas have started to hold for good. The successors of a state come from the
+ * SatSolver, on the encoding of the closure given by the Solver and assuming
+ * the formulas of the state and the invariants: every assignment found is
+ * cut down to the formulas these need, as chosen by the assignment for its
+ * disjunctions, and the arguments of its tomorrow formulas are the next
+ * state. A clause then blocks that set of tomorrow formulas, and its
+ * supersets, whose states are bound to be harder, until the state has no
+ * successor left. The clauses of each such run are tied to a selector
+ * variable, as in the PropositionalEngine.
+ *
+ * Once the persistent formulas hold, every edge is labelled by the fairness
+ * conditions holding in its state and by the responses it does not leave
+ * pending, which are looked for one at a time. A
+ * model is a cycle reachable from the initial state going through an edge of
+ * each label, that is a strongly connected component with all of them. The
+ * graph is searched depth-first, merging the components on the way as in
+ * Couvreur's algorithm, so that the search stops as soon as one of them has
+ * every label, and every edge is looked at once whatever the number of
+ * fairness conditions.
+ *
+ * There is no notion of depth in this search, hence the Solver only picks
+ * this engine when it has no maximum depth.
+ */
+class FairCycleEngine : public Engine {
+  using Variable = SatSolver::Variable;
+  using Literal = SatSolver::Literal;
+
+public:
+  explicit FairCycleEngine(Solver &solver)
+    : _solver(solver),
+      _sat(),
+      _selector(0),
+      _retired(0),
+      _start(),
+      _invariants(),
+      _persistent(),
+      _fairness(),
+      _responses(),
+      _nodes(),
+      _index(),
+      _order(),
+      _roots(),
+      _todo(),
+      _live(),
+      _count(0),
+      _started(false),
+      _memory(0),
+      _budget_countdown(BUDGET_CHECK_INTERVAL),
+      _assumptions(),
+      _model()
+  {
+    assert(solver._maximum_depth >= FrameID::max());
+
+    _rebuild();
+    _select(solver._initial);
+  }
+
+  virtual ~FairCycleEngine() override {}
+
+  virtual Outcome solution() override
+  {
+    if (!_started) {
+      _started = true;
+      _push(_node(_start, _persistent.none()), DynamicBitset(_labels()));
+    }
+
+    while (!_todo.empty()) {
+      if (_out_of_budget())
+        return Outcome::INTERRUPTED;
+
+      Visit &visit = _todo.back();
+      const Node &node = _nodes[visit.node];
+
+      if (visit.edge < node.edges.size()) {
+        const Edge &edge = node.edges[visit.edge++];
+
+        if (_order[edge.target] == UNVISITED)
+          _push(edge.target, edge.labels);
+        else if (_order[edge.target] != DEAD &&
+                 _merge(_order[edge.target], edge.labels)) {
+          _make_model();
+          return Outcome::SATISFIABLE;
+        }
+        continue;
+      }
+
+      uint32_t id = visit.node;
+      _todo.pop_back();
+      if (_roots.back().order == _order[id])
+        _pop_component(id);
+    }
+
+    return Outcome::EXHAUSTED;
+  }
+
+  virtual ModelPtr model() const override { return _model; }
+
+  virtual void reset(const DynamicBitset &initial) override
+  {
+    _nodes.clear();
+    _index[0].clear();
+    _index[1].clear();
+    _order.clear();
+    _roots.clear();
+    _todo.clear();
+    _live.clear();
+    _count = 0;
+    _started = false;
+    _memory = 0;
+    _model = nullptr;
+
+    _select(initial);
+  }
+
+private:
+  static constexpr uint32_t BUDGET_CHECK_INTERVAL = 256;
+
+  // Retired selectors tolerated before building the SatSolver anew
+  static constexpr size_t MINIMUM_RETIRED = 1024;
+
+  /* Search order of the nodes, besides the actual numbers */
+  static constexpr uint32_t UNVISITED = 0;
+  static constexpr uint32_t DEAD = UINT32_MAX;
+
+  // Label 0 is on every edge once the persistent formulas hold, label i on
+  // the ones where the i-th fairness condition holds too, and the labels
+  // after the fairness conditions on the ones leaving no response pending
+  struct Edge
+  {
+    uint32_t target;
+    DynamicBitset labels;
+    DynamicBitset next;      // The tomorrow formulas leading to the target
+    DynamicBitset expansion; // What holds in the state
+  };
+
+  struct Node
+  {
+    DynamicBitset formulas;
+    bool persistent;
+    std::vector<Edge> edges;
+  };
+
+  // A strongly connected component still open on the search path
+  struct Root
+  {
+    uint32_t order;
+    DynamicBitset labels;  // Of the edges inside of it
+    DynamicBitset arrival; // Of the edge the search has come in from
+  };
+
+  struct Visit
+  {
+    uint32_t node;
+    uint32_t edge; // The next one to follow
+  };
+
+  struct Hash
+  {
+    size_t operator()(const DynamicBitset &formulas) const
+    {
+      return size_t(formulas.hash());
+    }
+  };
+
+  Solver &_solver;
+  std::unique_ptr<CdclSolver> _sat;
+  Variable _selector;
+  size_t _retired;
+
+  /* The initial formulas, sorted by their role */
+  DynamicBitset _start;
+  DynamicBitset _invariants;
+  DynamicBitset _persistent;
+  std::vector<uint64_t> _fairness;
+  std::vector<uint64_t> _responses;
+
+  /* The graph built so far, the nodes indexed by their persistence */
+  std::vector<Node> _nodes;
+  std::unordered_map<DynamicBitset, uint32_t, Hash> _index[2];
+
+  /* The state of the search */
+  std::vector<uint32_t> _order;
+  std::vector<Root> _roots;
+  std::vector<Visit> _todo;
+  std::vector<uint32_t> _live; // Nodes of the open components
+  uint32_t _count;
+  bool _started;
+
+  size_t _memory;
+  uint32_t _budget_countdown;
+  std::vector<Literal> _assumptions;
+  ModelPtr _model;
+
+  size_t _labels() const { return _fairness.size() + _responses.size() + 1; }
+
+  size_t _bitset_bytes(size_t bits) const
+  {
+    return blocks_for(bits) * sizeof(uint64_t);
+  }
+
+  void _rebuild()
+  {
+    _sat = std::make_unique<CdclSolver>();
+    _solver._encode_closure(*_sat);
+    _retired = 0;
+  }
+
+  // Sorts the initial formulas by their role
+  void _select(const DynamicBitset &initial)
+  {
+    const size_t number_of_formulas = _solver._number_of_formulas;
+
+    _start = DynamicBitset(number_of_formulas);
+    _invariants = DynamicBitset(number_of_formulas);
+    _persistent = DynamicBitset(number_of_formulas);
+    _fairness.clear();
+    _responses.clear();
+
+    for (size_t f = initial.find_first(); f != DynamicBitset::npos;
+         f = initial.find_next(f))
+      _split(f, _start);
+
+    for (std::vector<uint64_t> *formulas : {&_fairness, &_responses}) {
+      std::sort(formulas->begin(), formulas->end());
+      formulas->erase(std::unique(formulas->begin(), formulas->end()),
+                      formulas->end());
+    }
+  }
+
+  // Puts the formula where it belongs, given the role of the one it comes
+  // from: the always formulas nested in other ones are the same as them, an
+  // eventually always formula is persistent wherever it is, and eventually
+  // formulas under one of them are fairness conditions
+  void _split(uint64_t f, DynamicBitset &role)
+  {
+    const auto &bitset = _solver._bitset;
+    const std::vector<FormulaID> &lhs = _solver._lhs;
+    const std::vector<FormulaID> &rhs = _solver._rhs;
+
+    if (bitset.conjunction[f]) {
+      _split(lhs[f], role);
+      _split(rhs[f], role);
+    }
+    else if (bitset.always[f])
+      _split(lhs[f], &role == &_start ? _invariants : role);
+    else if (bitset.eventually[f] && bitset.always[lhs[f]])
+      _split(lhs[lhs[f]], _persistent);
+    else if (bitset.eventually[f] && &role != &_start)
+      _fairness.push_back(lhs[f]);
+    else {
+      role.set(f);
+      _find_responses(f);
+    }
+  }
+
+  void _find_responses(uint64_t f)
+  {
+    const auto &bitset = _solver._bitset;
+
+    if (bitset.conjunction[f] || bitset.disjunction[f]) {
+      _find_responses(_solver._lhs[f]);
+      _find_responses(_solver._rhs[f]);
+    }
+    else if (bitset.eventually[f])
+      _responses.push_back(f);
+  }
+
+  uint32_t _node(const DynamicBitset &formulas, bool persistent)
+  {
+    auto &index = _index[persistent];
+    auto found = index.find(formulas);
+    if (found != index.end())
+      return found->second;
+
+    uint32_t id = uint32_t(_nodes.size());
+    _nodes.push_back({formulas, persistent, {}});
+    _order.push_back(UNVISITED);
+    index.emplace(formulas, id);
+
+    _memory += sizeof(Node) + sizeof(uint32_t) + 4 * sizeof(void *) +
+               2 * _bitset_bytes(formulas.size());
+
+    return id;
+  }
+
+  void _push(uint32_t id, const DynamicBitset &arrival)
+  {
+    Solver::Stats &stats = _solver._stats;
+
+    _order[id] = ++_count;
+    _roots.push_back({_count, DynamicBitset(_labels()), arrival});
+    _live.push_back(id);
+    _todo.push_back({id, 0});
+
+    _expand(id);
+
+    ++stats.total_frames;
+    stats.maximum_frames =
+      std::max(stats.maximum_frames, uint64_t(_todo.size()));
+    if (_nodes[id].edges.empty())
+      ++stats.cross_by_contradiction;
+  }
+
+  // Merges the components opened after the node with the given order into
+  // the one it belongs to, as an edge with the given labels closes a cycle
+  // through them. Tells whether it has every label, in which case the cycle
+  // makes a model, maybe another one than the previous time.
+  bool _merge(uint32_t order, const DynamicBitset &labels)
+  {
+    DynamicBitset merged = labels;
+    while (_roots.back().order > order) {
+      merged |= _roots.back().labels;
+      merged |= _roots.back().arrival;
+      _roots.pop_back();
+    }
+
+    Root &root = _roots.back();
+    root.labels |= merged;
+
+    return root.labels.count() == _labels();
+  }
+
+  // Closes the component of the given root, which has no way back to the
+  // search path, so that its nodes are never looked at again
+  void _pop_component(uint32_t root)
+  {
+    uint32_t order = _order[root];
+    _roots.pop_back();
+
+    while (!_live.empty() && _order[_live.back()] >= order) {
+      Node &node = _nodes[_live.back()];
+      for (const Edge &edge : node.edges)
+        _memory -= _edge_bytes(edge);
+      node.edges = std::vector<Edge>();
+
+      _order[_live.back()] = DEAD;
+      _live.pop_back();
+    }
+  }
+
+  size_t _edge_bytes(const Edge &edge) const
+  {
+    return sizeof(Edge) + _bitset_bytes(edge.labels.size()) +
+           2 * _bitset_bytes(edge.next.size());
+  }
+
+  // Finds all the edges of the node, the labelled ones first so that the
+  // unlabelled run only has to look for what they do not already cover
+  void _expand(uint32_t id)
+  {
+    if (!_nodes[id].persistent) {
+      _enumerate(id, false, 0);
+      _enumerate(id, true, 0);
+      return;
+    }
+
+    for (size_t label = 1; label < _labels(); ++label)
+      _enumerate(id, true, label);
+    _enumerate(id, true, 0);
+  }
+
+  // Adds the edges from the node to the nodes of the given persistence whose
+  // state has the given label, if any
+  void _enumerate(uint32_t id, bool persistent, size_t label)
+  {
+    const DynamicBitset formulas = _nodes[id].formulas;
+    const bool labelled = _nodes[id].persistent;
+    const size_t number_of_formulas = _solver._number_of_formulas;
+
+    DynamicBitset required = formulas;
+    required |= _invariants;
+    if (persistent)
+      required |= _persistent;
+    if (label > 0 && label <= _fairness.size())
+      required.set(_fairness[label - 1]);
+
+    _activate();
+    for (const Edge &edge : _nodes[id].edges)
+      if (_nodes[edge.target].persistent == persistent &&
+          (label == 0 || edge.labels[label]))
+        _block(edge.next);
+
+    _assumptions.clear();
+    _assumptions.push_back(SatSolver::positive(_selector));
+    for (size_t f = required.find_first(); f != DynamicBitset::npos;
+         f = required.find_next(f))
+      _assumptions.push_back(SatSolver::positive(Variable(f)));
+    if (label > _fairness.size())
+      _assumptions.push_back(
+        SatSolver::negative(Variable(_carried(label - _fairness.size() - 1))));
+
+    while (_sat->solve(_assumptions)) {
+      Edge edge = {0, DynamicBitset(_labels()),
+                   DynamicBitset(number_of_formulas),
+                   DynamicBitset(number_of_formulas)};
+
+      // The fairness conditions the assignment fulfils anyway come for free
+      DynamicBitset needed = required;
+      if (labelled) {
+        edge.labels.set(0);
+        for (size_t i = 0; i < _fairness.size(); ++i) {
+          if (_sat->value(Variable(_fairness[i]))) {
+            needed.set(_fairness[i]);
+            edge.labels.set(i + 1);
+          }
+        }
+      }
+
+      _justify(needed, edge.expansion);
+
+      if (labelled)
+        for (size_t i = 0; i < _responses.size(); ++i)
+          if (!edge.expansion[_carried(i)])
+            edge.labels.set(_fairness.size() + i + 1);
+
+      DynamicBitset successor(number_of_formulas);
+      for (size_t f = edge.expansion.find_first(); f != DynamicBitset::npos;
+           f = edge.expansion.find_next(f)) {
+        if (_solver._bitset.tomorrow[f]) {
+          successor.set(_solver._lhs[f]);
+          edge.next.set(f);
+        }
+      }
+
+      _block(edge.next);
+
+      edge.target = _node(successor, persistent);
+      _memory += _edge_bytes(edge);
+      _nodes[id].edges.push_back(std::move(edge));
+      ++_solver._stats.total_steps;
+    }
+
+    _retire();
+  }
+
+  void _activate()
+  {
+    if (_retired >= std::max(MINIMUM_RETIRED, _solver._number_of_formulas))
+      _rebuild();
+
+    _selector = _sat->new_variable();
+  }
+
+  void _retire()
+  {
+    _sat->add_clause({SatSolver::negative(_selector)});
+    ++_retired;
+  }
+
+  // Blocks the given tomorrow formulas, and any superset of them
+  void _block(const DynamicBitset &next)
+  {
+    std::vector<Literal> blocking = {SatSolver::negative(_selector)};
+    for (size_t f = next.find_first(); f != DynamicBitset::npos;
+         f = next.find_next(f))
+      blocking.push_back(SatSolver::negative(Variable(f)));
+
+    _sat->add_clause(std::move(blocking));
+  }
+
+  // The tomorrow formula carrying on the given response while it is pending
+  uint64_t _carried(size_t response) const { return _responses[response] + 1; }
+
+  // The formulas of the assignment the given ones need, following the
+  // disjuncts it has chosen, and fulfilling the responses when it does.
+  // Local formulas need nothing else.
+  void _justify(const DynamicBitset &formulas, DynamicBitset &expansion)
+  {
+    const auto &bitset = _solver._bitset;
+    const std::vector<FormulaID> &lhs = _solver._lhs;
+    const std::vector<FormulaID> &rhs = _solver._rhs;
+
+    expansion = formulas;
+    std::vector<uint64_t> pending;
+    for (size_t f = formulas.find_first(); f != DynamicBitset::npos;
+         f = formulas.find_next(f))
+      pending.push_back(f);
+
+    auto need = [&](uint64_t f) {
+      if (!expansion[f]) {
+        expansion.set(f);
+        pending.push_back(f);
+      }
+    };
+
+    while (!pending.empty()) {
+      uint64_t f = pending.back();
+      pending.pop_back();
+
+      if (bitset.conjunction[f]) {
+        need(lhs[f]);
+        need(rhs[f]);
+      }
+      else if (bitset.disjunction[f] && !expansion[lhs[f]] &&
+               !expansion[rhs[f]])
+        need(_sat->value(Variable(uint64_t(lhs[f]))) ? lhs[f] : rhs[f]);
+      else if (bitset.eventually[f] && !expansion[lhs[f]] &&
+               !expansion[f + 1])
+        need(_sat->value(Variable(uint64_t(lhs[f]))) ? uint64_t(lhs[f])
+                                                      : f + 1);
+    }
+  }
+
+  // The search path down to the component with every label, then around it
+  // through an edge of each label, the one with most labels still missing
+  // among the closest ones
+  void _make_model()
+  {
+    const uint32_t order = _roots.back().order;
+    std::vector<const Edge *> path;
+
+    size_t visit = 0;
+    for (; _order[_todo[visit].node] != order; ++visit) {
+      const Node &node = _nodes[_todo[visit].node];
+      path.push_back(&node.edges[_todo[visit].edge - 1]);
+    }
+
+    const uint32_t root = _todo[visit].node;
+    const size_t loop = path.size();
+    uint32_t current = root;
+    DynamicBitset covered(_labels());
+
+    while (true) {
+      size_t missing = 0;
+      while (missing < _labels() && covered[missing])
+        ++missing;
+
+      if (missing == _labels()) {
+        if (current != root)
+          _walk(current, order, path, [&](const Edge &edge) {
+            return edge.target == root ? size_t(1) : size_t(0);
+          });
+        break;
+      }
+
+      current = _walk(current, order, path, [&](const Edge &edge) {
+        if (!edge.labels[missing])
+          return size_t(0);
+        DynamicBitset added = edge.labels;
+        added -= covered;
+        return added.count();
+      });
+
+      for (size_t i = loop; i < path.size(); ++i)
+        covered |= path[i]->labels;
+    }
+
+    _model = std::make_shared<Model>();
+    for (const Edge *edge : path)
+      _model->states.push_back(_state(edge->expansion));
+    _model->loop_state = loop;
+
+    _solver._stats.maximum_model_size =
+      std::max(_solver._stats.maximum_model_size, uint64_t(path.size()));
+  }
+
+  // Goes from the node to the closest one, inside the component of the given
+  // order, with an edge in the component scoring something, and takes the
+  // best scoring such edge. Returns where it has arrived.
+  template <typename Score>
+  uint32_t _walk(uint32_t from, uint32_t order,
+                 std::vector<const Edge *> &path, Score score)
+  {
+    auto inside = [&](uint32_t node) {
+      return _order[node] >= order && _order[node] != DEAD;
+    };
+
+    // The node each one has been reached from, and by which edge
+    std::unordered_map<uint32_t, std::pair<uint32_t, const Edge *>> parent;
+    std::deque<uint32_t> queue = {from};
+    parent[from] = {from, nullptr};
+
+    while (!queue.empty()) {
+      uint32_t node = queue.front();
+      queue.pop_front();
+
+      const Edge *best = nullptr;
+      size_t best_score = 0;
+      for (const Edge &edge : _nodes[node].edges) {
+        if (!inside(edge.target))
+          continue;
+
+        size_t s = score(edge);
+        if (s > best_score) {
+          best = &edge;
+          best_score = s;
+        }
+        if (parent.find(edge.target) == parent.end()) {
+          parent[edge.target] = {node, &edge};
+          queue.push_back(edge.target);
+        }
+      }
+
+      if (best) {
+        size_t end = path.size();
+        for (uint32_t n = node; n != from; n = parent[n].first)
+          path.push_back(parent[n].second);
+        std::reverse(path.begin() + std::ptrdiff_t(end), path.end());
+        path.push_back(best);
+        return best->target;
+      }
+    }
+
+    assert(false && "The component is strongly connected");
+    return from;
+  }
+
+  LTL::detail::State _state(const DynamicBitset &expansion) const
+  {
+    LTL::detail::State state;
+    for (size_t f = expansion.find_first(); f != DynamicBitset::npos;
+         f = expansion.find_next(f)) {
+      auto atom = _solver._atom_set.find(FormulaID(f));
+      if (atom != _solver._atom_set.end())
+        state.insert(LTL::detail::Literal(atom->second));
+      else if (_solver._bitset.negation[f]) {
+        atom = _solver._atom_set.find(_solver._lhs[f]);
+        if (atom != _solver._atom_set.end())
+          state.insert(LTL::detail::Literal(atom->second, false));
+      }
+    }
+
+    return state;
+  }
+
+  bool _out_of_budget()
+  {
+    const Solver::Budget &budget = _solver._budget;
+
+    if (_solver._stats.total_frames >= budget.frames ||
+        (budget.cancel && budget.cancel->load(std::memory_order_relaxed)))
+      return true;
+
+    if (--_budget_countdown > 0)
+      return false;
+    _budget_countdown = BUDGET_CHECK_INTERVAL;
+
+    return _memory >= budget.memory || Solver::Clock::now() >= budget.deadline;
+  }
+};
+}
+}
@@ -22,6 +22,7 @@ namespace format {
 
 namespace {
 std::atomic<LogLevel> level{Message};
+thread_local int thread_level = -1; // Unset
 }
 
 void set_verbosity_level(LogLevel l)
@@ -29,9 +30,14 @@ void set_verbosity_level(LogLevel l)
   level = l;
 }
 
+void set_thread_verbosity_level(LogLevel l)
+{
+  thread_level = l;
+}
+
 LogLevel verbosity_level()
 {
-  return level;
+  return thread_level < 0 ? level.load() : static_cast<LogLevel>(thread_level);
 }
 }
 }
@@ -0,0 +1,106 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace LTL {
+namespace detail {
+
+/*
+ * Index of the frames of the current branch by the fingerprint of their
+ * formulas, used to find the latest frame with the same formulas as the top
+ * one without walking the whole branch.
+ *
+ * It is a multimap: the table holds the latest frame for each fingerprint,
+ * and every frame links to the previous one of the branch with the same
+ * fingerprint through its `same` field.
+ *
+ * The table uses linear probing. Frames are only ever added and removed in
+ * stack order, so a removed slot can simply be emptied: every key inserted
+ * after it, whose probe sequence might have crossed it, is already gone.
+ */
+template <typename Frame>
+class FrameIndex {
+public:
+  FrameIndex() : _slots(INITIAL_SIZE, nullptr), _size(0) {}
+
+  // The latest frame of the branch with the given fingerprint, if any
+  Frame *find(uint64_t fingerprint) const
+  {
+    return _slots[probe(fingerprint)];
+  }
+
+  // Adds a frame on top of the branch. The frames of the branch are needed in
+  // stack order to rebuild the table when it grows.
+  template <typename Stack>
+  void push(Frame &frame, Stack &branch)
+  {
+    size_t i = probe(frame.fingerprint);
+    frame.same = _slots[i];
+    _slots[i] = &frame;
+
+    if (!frame.same && ++_size * 2 > _slots.size())
+      grow(branch);
+  }
+
+  // Removes the frame on top of the branch
+  void pop(Frame &frame)
+  {
+    size_t i = probe(frame.fingerprint);
+    assert(_slots[i] == &frame);
+
+    _slots[i] = frame.same;
+    if (!frame.same)
+      --_size;
+  }
+
+  size_t allocated_bytes() const { return _slots.size() * sizeof(Frame *); }
+
+private:
+  static constexpr size_t INITIAL_SIZE = 64;
+
+  std::vector<Frame *> _slots;
+  size_t _size;
+
+  size_t probe(uint64_t fingerprint) const
+  {
+    size_t mask = _slots.size() - 1;
+    size_t i = fingerprint & mask;
+
+    while (_slots[i] && _slots[i]->fingerprint != fingerprint)
+      i = (i + 1) & mask;
+
+    return i;
+  }
+
+  // Reinserts the whole branch from the bottom, so that the slots end up as
+  // if the frames were pushed in order in the bigger table
+  template <typename Stack>
+  void grow(Stack &branch)
+  {
+    _slots.assign(_slots.size() * 2, nullptr);
+
+    for (Frame &frame : branch)
+      _slots[probe(frame.fingerprint)] = &frame;
+  }
+};
+}
+}
@@ -0,0 +1,193 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include "bitset.hpp"
+#include "identifiable.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace LTL {
+namespace detail {
+
+/*
+ * Sets of formulas which cannot be all in the same state, learned by the
+ * tableau from the contradictions it meets. Unlike the NogoodCache, which
+ * only knows whole states, a clause matches any state it is a subset of.
+ *
+ * Every clause is watched by one of its formulas, and it is only looked at
+ * for the states having that formula. The watch is then moved to one of its
+ * formulas the state does not have, if any: as most states are close to the
+ * previous one, it is likely to be missing from the next as well.
+ *
+ * Clauses are bumped in activity when they match, and once there are too
+ * many, the least active half of them is deleted, as the learnt clauses of
+ * the CdclSolver.
+ */
+template <typename Bitset>
+class LearnedClauses {
+public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  explicit LearnedClauses(size_t number_of_formulas)
+    : _clauses(),
+      _watches(number_of_formulas),
+      _maximum(1000),
+      _increment(1),
+      _formulas(0),
+      _deletions(0)
+  {
+  }
+
+  // Returns the index of a clause made only of formulas of the given ones,
+  // or npos. The index is valid until the next call to add().
+  size_t find(const Bitset &formulas)
+  {
+    size_t one = formulas.find_first();
+    while (one != Bitset::npos) {
+      std::vector<uint32_t> &watches = _watches[one];
+
+      size_t i = 0;
+      while (i < watches.size()) {
+        Clause &clause = _clauses[watches[i]];
+
+        auto missing = std::find_if(
+          clause.formulas.begin(), clause.formulas.end(),
+          [&](FormulaID formula) { return !formulas[formula]; });
+
+        if (missing == clause.formulas.end()) {
+          _bump(clause);
+          return watches[i];
+        }
+
+        _watches[*missing].push_back(watches[i]);
+        watches[i] = watches.back();
+        watches.pop_back();
+      }
+
+      one = formulas.find_next(one);
+    }
+
+    return npos;
+  }
+
+  const std::vector<FormulaID> &operator[](size_t index) const
+  {
+    return _clauses[index].formulas;
+  }
+
+  void add(const Bitset &formulas)
+  {
+    assert(formulas.any());
+
+    if (_clauses.size() >= _maximum)
+      _reduce();
+
+    _clauses.push_back({{}, 0});
+    Clause &clause = _clauses.back();
+    for (size_t one = formulas.find_first(); one != Bitset::npos;
+         one = formulas.find_next(one))
+      clause.formulas.push_back(FormulaID(one));
+
+    _formulas += clause.formulas.size();
+    _watches[clause.formulas.front()].push_back(
+      static_cast<uint32_t>(_clauses.size() - 1));
+
+    _bump(clause);
+    _increment /= DECAY;
+  }
+
+  size_t size() const { return _clauses.size(); }
+
+  uint64_t deletions() const { return _deletions; }
+
+  // Memory held by the clauses and their watches, roughly
+  size_t allocated_bytes() const
+  {
+    return _clauses.capacity() * sizeof(Clause) +
+           _watches.size() * sizeof(std::vector<uint32_t>) +
+           _formulas * (sizeof(FormulaID) + sizeof(uint32_t));
+  }
+
+private:
+  static constexpr double DECAY = 0.999;
+  static constexpr double RESCALE_LIMIT = 1e100;
+
+  struct Clause
+  {
+    std::vector<FormulaID> formulas;
+    double activity;
+  };
+
+  std::vector<Clause> _clauses;
+  std::vector<std::vector<uint32_t>> _watches; // By formula
+  size_t _maximum;
+  double _increment;
+  size_t _formulas; // Over all the clauses
+  uint64_t _deletions;
+
+  void _bump(Clause &clause)
+  {
+    if ((clause.activity += _increment) > RESCALE_LIMIT) {
+      for (Clause &other : _clauses)
+        other.activity /= RESCALE_LIMIT;
+      _increment /= RESCALE_LIMIT;
+    }
+  }
+
+  // Deletes the clauses less active than the median, and watches the others
+  // again on their first formula
+  void _reduce()
+  {
+    std::vector<double> activities;
+    activities.reserve(_clauses.size());
+    for (const Clause &clause : _clauses)
+      activities.push_back(clause.activity);
+
+    auto median = activities.begin() + activities.size() / 2;
+    std::nth_element(activities.begin(), median, activities.end());
+    double threshold = *median;
+
+    for (std::vector<uint32_t> &watches : _watches)
+      watches.clear();
+
+    size_t size = 0;
+    _formulas = 0;
+    for (size_t i = 0; i < _clauses.size(); ++i) {
+      if (_clauses[i].activity < threshold) {
+        ++_deletions;
+        continue;
+      }
+      if (size != i)
+        _clauses[size] = std::move(_clauses[i]);
+
+      _formulas += _clauses[size].formulas.size();
+      _watches[_clauses[size].formulas.front()].push_back(
+        static_cast<uint32_t>(size));
+      ++size;
+    }
+    _clauses.resize(size);
+
+    _maximum += _maximum / 10;
+  }
+};
+}
+}
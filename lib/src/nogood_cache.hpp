@@ -0,0 +1,193 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include "bitset.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace LTL {
+namespace detail {
+
+/* Default memory budget of the cache of closed subtrees */
+static constexpr size_t NOGOOD_CACHE_BYTES = size_t(64) << 20;
+
+/* Default number of states kept when the cache is the set of visited ones */
+static constexpr size_t VISITED_STATES = size_t(1) << 21;
+
+/*
+ * Set of formula sets known to be unsatisfiable, used by the tableau to
+ * cross any state it has already seen failing.
+ *
+ * It is a set-associative hash table: each key can only live in one of the
+ * WAYS slots of the bucket selected by its hash. The table starts small and
+ * doubles while it stays within the memory budget. After that, inserting in
+ * a full bucket evicts its least recently used entry.
+ */
+template <typename Bitset>
+class NogoodCache {
+public:
+  static constexpr size_t WAYS = 4;
+
+  NogoodCache(size_t number_of_formulas, size_t budget = NOGOOD_CACHE_BYTES)
+    : _number_of_formulas(number_of_formulas),
+      _slot_bytes(slot_bytes(number_of_formulas)),
+      _budget(budget),
+      _slots(),
+      _size(0),
+      _clock(0),
+      _evictions(0)
+  {
+  }
+
+  bool contains(const Bitset &formulas)
+  {
+    if (_slots.empty())
+      return false;
+
+    uint64_t hash = formulas.hash();
+    Slot *bucket = &_slots[index_of(hash)];
+
+    for (size_t i = 0; i < WAYS; ++i) {
+      if (bucket[i].used && bucket[i].hash == hash &&
+          bucket[i].formulas == formulas) {
+        bucket[i].stamp = ++_clock;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void insert(const Bitset &formulas)
+  {
+    if (_slots.empty() || _size >= _slots.size() / 4 * 3)
+      grow();
+
+    if (_slots.empty())
+      return;
+
+    store(formulas, formulas.hash());
+  }
+
+  size_t size() const { return _size; }
+
+  uint64_t evictions() const { return _evictions; }
+
+  // Memory currently held by the cache, including unused slots
+  size_t allocated_bytes() const { return _slots.size() * _slot_bytes; }
+
+  // Memory held by each entry for the given closure size
+  static size_t slot_bytes(size_t number_of_formulas)
+  {
+    return sizeof(Slot) + heap_bytes(Bitset(number_of_formulas));
+  }
+
+private:
+  struct Slot
+  {
+    uint64_t hash;
+    uint64_t stamp; // Last time the entry has been used, for eviction
+    bool used;
+    Bitset formulas;
+
+    explicit Slot(size_t number_of_formulas)
+      : hash(0), stamp(0), used(false), formulas(number_of_formulas)
+    {
+    }
+  };
+
+  const size_t _number_of_formulas;
+  const size_t _slot_bytes;
+  const size_t _budget;
+
+  std::vector<Slot> _slots;
+  size_t _size;
+  uint64_t _clock;
+  uint64_t _evictions;
+
+  template <size_t Blocks>
+  static size_t heap_bytes(const FixedBitset<Blocks> &)
+  {
+    return 0;
+  }
+
+  static size_t heap_bytes(const DynamicBitset &bitset)
+  {
+    return bitset.num_blocks() * sizeof(uint64_t);
+  }
+
+  // The number of slots is always a power of two multiple of WAYS
+  size_t index_of(uint64_t hash) const
+  {
+    return (hash & (_slots.size() / WAYS - 1)) * WAYS;
+  }
+
+  void store(const Bitset &formulas, uint64_t hash)
+  {
+    Slot *bucket = &_slots[index_of(hash)];
+    Slot *victim = &bucket[0];
+
+    for (size_t i = 0; i < WAYS; ++i) {
+      if (bucket[i].used && bucket[i].hash == hash &&
+          bucket[i].formulas == formulas) {
+        bucket[i].stamp = ++_clock;
+        return;
+      }
+    }
+
+    for (size_t i = 0; i < WAYS; ++i) {
+      if (!bucket[i].used) {
+        victim = &bucket[i];
+        break;
+      }
+      if (bucket[i].stamp < victim->stamp)
+        victim = &bucket[i];
+    }
+
+    if (victim->used)
+      ++_evictions;
+    else
+      ++_size;
+
+    victim->hash = hash;
+    victim->stamp = ++_clock;
+    victim->used = true;
+    victim->formulas = formulas;
+  }
+
+  // Doubles the table if the budget allows it, rehashing every entry
+  void grow()
+  {
+    size_t slots = _slots.empty() ? WAYS * 64 : _slots.size() * 2;
+    if (slots * _slot_bytes > _budget)
+      return;
+
+    std::vector<Slot> old(slots, Slot(_number_of_formulas));
+    old.swap(_slots);
+    _size = 0;
+
+    for (Slot &slot : old)
+      if (slot.used)
+        store(slot.formulas, slot.hash);
+  }
+};
+}
+}
@@ -0,0 +1,200 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include "engine.hpp"
+#include "tableau.hpp"
+#include "work_queue.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace LTL {
+namespace detail {
+
+/*
+ * Runs a Tableau per thread over the same closure. The first worker starts
+ * from the initial state, and the others get their work from the open choices
+ * of the busy ones through the WorkQueue (see tableau.hpp). The first model
+ * found, or the first worker running out of budget, cancels the search, and
+ * every worker keeps its state so that the next run goes on from where each
+ * of them stopped.
+ *
+ * Each worker has its own statistics and nogood cache, and a share of the
+ * frames and memory budgets. The statistics are merged into the Solver's ones
+ * at the end of every run.
+ */
+template <typename Bitset>
+class ParallelTableau : public Engine {
+  using Worker = Tableau<Bitset>;
+
+public:
+  ParallelTableau(Solver &solver, uint32_t number_of_threads);
+  virtual ~ParallelTableau() override {}
+
+  virtual Outcome solution() override;
+  virtual ModelPtr model() const override;
+  virtual void reset(const DynamicBitset &initial) override;
+
+private:
+  enum class Status : uint8_t {
+    IDLE,        // Waiting for a task
+    BUSY,        // Stopped by another worker in the middle of a task
+    INTERRUPTED, // Ran out of budget in the middle of a task
+    FOUND,       // Found a model, not yet given to the user
+    REPORTED     // Found the model given to the user
+  };
+
+  Solver &_solver;
+  WorkQueue _queue;
+
+  std::vector<Solver::Stats> _stats;
+  std::vector<Solver::Stats> _merged; // As of the previous merge
+  std::vector<std::unique_ptr<Worker>> _workers;
+  std::vector<Status> _status;
+  size_t _winner;
+
+  void _work(size_t i);
+  bool _report_model();
+  void _merge_stats();
+};
+
+template <typename Bitset>
+ParallelTableau<Bitset>::ParallelTableau(Solver &solver,
+                                         uint32_t number_of_threads)
+  : _solver(solver),
+    _queue(),
+    _stats(number_of_threads),
+    _merged(number_of_threads),
+    _workers(),
+    _status(number_of_threads, Status::IDLE),
+    _winner(0)
+{
+  assert(number_of_threads > 0);
+
+  for (size_t i = 0; i < number_of_threads; ++i)
+    _workers.push_back(
+      std::make_unique<Worker>(solver, _stats[i], &_queue, number_of_threads));
+
+  // The whole tableau, for the first worker to take
+  _queue.give(WorkQueue::Path());
+}
+
+template <typename Bitset>
+Engine::Outcome ParallelTableau<Bitset>::solution()
+{
+  // Models found by the losers of the previous run come first
+  if (_report_model())
+    return Outcome::SATISFIABLE;
+
+  _queue.resume();
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < _workers.size(); ++i)
+    threads.emplace_back(&ParallelTableau::_work, this, i);
+
+  for (std::thread &thread : threads)
+    thread.join();
+
+  _merge_stats();
+
+  if (_report_model())
+    return Outcome::SATISFIABLE;
+
+  if (std::find(_status.begin(), _status.end(), Status::INTERRUPTED) !=
+      _status.end())
+    return Outcome::INTERRUPTED;
+
+  return Outcome::EXHAUSTED;
+}
+
+template <typename Bitset>
+void ParallelTableau<Bitset>::_work(size_t i)
+{
+  Worker &worker = *_workers[i];
+  Outcome outcome = Outcome::EXHAUSTED;
+
+  if (_status[i] != Status::IDLE)
+    outcome = worker.search();
+
+  WorkQueue::Path path;
+  while (outcome == Outcome::EXHAUSTED) {
+    if (_status[i] != Status::IDLE) {
+      _status[i] = Status::IDLE;
+      _queue.finish();
+    }
+
+    if (!_queue.take(path))
+      return;
+
+    _status[i] = Status::BUSY;
+    outcome = worker.start(path);
+  }
+
+  if (outcome == Outcome::SATISFIABLE) {
+    _status[i] = Status::FOUND;
+    _queue.cancel();
+  }
+  else if (outcome == Outcome::INTERRUPTED)
+    _status[i] = Status::INTERRUPTED;
+  else
+    _status[i] = Status::BUSY;
+}
+
+template <typename Bitset>
+bool ParallelTableau<Bitset>::_report_model()
+{
+  auto found = std::find(_status.begin(), _status.end(), Status::FOUND);
+  if (found == _status.end())
+    return false;
+
+  *found = Status::REPORTED;
+  _winner = static_cast<size_t>(found - _status.begin());
+
+  return true;
+}
+
+template <typename Bitset>
+void ParallelTableau<Bitset>::_merge_stats()
+{
+  for (size_t i = 0; i < _stats.size(); ++i) {
+    add_stats(_solver._stats, _stats[i], _merged[i]);
+    _merged[i] = _stats[i];
+  }
+}
+
+template <typename Bitset>
+void ParallelTableau<Bitset>::reset(const DynamicBitset &initial)
+{
+  for (std::unique_ptr<Worker> &worker : _workers)
+    worker->reset(initial);
+
+  _queue.clear();
+  _queue.give(WorkQueue::Path());
+  std::fill(_status.begin(), _status.end(), Status::IDLE);
+  _winner = 0;
+}
+
+template <typename Bitset>
+ModelPtr ParallelTableau<Bitset>::model() const
+{
+  return _workers[_winner]->model();
+}
+}
+}
@@ -0,0 +1,148 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#include "portfolio.hpp"
+
+#include "format.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace LTL {
+namespace detail {
+
+/* How often the race looks at the cancel flag given by the user */
+static constexpr std::chrono::milliseconds POLL_INTERVAL{10};
+
+std::vector<Portfolio::Configuration> Portfolio::configurations(size_t count)
+{
+  using Rule = Solver::Strategy::Rule;
+  using Branching = Solver::Strategy::Branching;
+  using Restarts = Solver::Strategy::Restarts;
+
+  std::vector<Configuration> configurations(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    Solver::Strategy &strategy = configurations[i].strategy;
+
+    switch (i) {
+      case 0:
+        break;
+      case 1:
+        strategy.branching = Branching::EVENTUALITIES;
+        break;
+      case 2:
+        strategy.lookahead = true;
+        break;
+      case 3:
+        strategy.branching = Branching::MOST_CONSTRAINED;
+        break;
+      case 4:
+        strategy.rules = {{Rule::CONJUNCTION, Rule::ALWAYS, Rule::EVENTUALLY,
+                           Rule::UNTIL, Rule::RELEASE, Rule::DISJUNCTION}};
+        strategy.second_alternative_first = true;
+        break;
+      case 5:
+        strategy.branching = Branching::MOST_SHARED;
+        break;
+      default:
+        strategy.branching = Branching::RANDOM;
+        strategy.restarts = Restarts::LUBY;
+        strategy.seed = i;
+        break;
+    }
+  }
+
+  return configurations;
+}
+
+Portfolio::Portfolio(FormulaPtr formula,
+                     std::vector<Configuration> configurations)
+  : _configurations(std::move(configurations)),
+    _solvers(),
+    _budget(),
+    _cancel(false),
+    _winner(static_cast<size_t>(-1))
+{
+  _solvers.reserve(_configurations.size());
+  for (const Configuration &configuration : _configurations) {
+    _solvers.emplace_back(
+      new Solver(formula, configuration.maximum_depth, 1));
+    _solvers.back()->set_strategy(configuration.strategy);
+  }
+}
+
+Solver::Result Portfolio::solution()
+{
+  if (Solver *solver = winner())
+    return solver->satisfiability();
+
+  Solver::Budget budget = _budget;
+  budget.cancel = &_cancel;
+  if (budget.memory != Solver::Budget().memory)
+    budget.memory /= _solvers.size();
+
+  _cancel = false;
+
+  std::mutex mutex;
+  std::condition_variable finished;
+  size_t running = _solvers.size();
+
+  std::vector<std::thread> threads;
+  threads.reserve(_solvers.size());
+  for (size_t i = 0; i < _solvers.size(); ++i) {
+    _solvers[i]->set_budget(budget);
+    threads.emplace_back([&, i] {
+      format::set_thread_verbosity_level(format::Silent);
+
+      Solver::Result result = _solvers[i]->solution();
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (result != Solver::Result::UNDEFINED && !winner()) {
+        _winner = i;
+        _cancel = true;
+      }
+      --running;
+      finished.notify_one();
+    });
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!finished.wait_for(lock, POLL_INTERVAL,
+                              [&] { return running == 0; }))
+      if (_budget.cancel && *_budget.cancel)
+        _cancel = true;
+  }
+
+  for (std::thread &thread : threads)
+    thread.join();
+
+  for (auto &solver : _solvers)
+    solver->set_budget(_budget);
+
+  if (Solver *solver = winner()) {
+    format::debug("Portfolio won by solver {} of {}", _winner,
+                  _solvers.size());
+    return solver->satisfiability();
+  }
+
+  return Solver::Result::UNDEFINED;
+}
+}
+}
@@ -0,0 +1,110 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include "engine.hpp"
+#include "sat_solver.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace LTL {
+namespace detail {
+
+/*
+ * Engine for the formulas without temporal operators, whose models are a
+ * single state looping on itself. The closure is handed to a SatSolver as
+ * encoded by the Solver, and every run looks for an assignment differing
+ * from the ones found before in some atom.
+ *
+ * The clauses blocking the models already found are tied to a selector
+ * variable, assumed true by the current search and fixed to false by
+ * reset(), so that they don't get in the way of the next one.
+ */
+class PropositionalEngine : public Engine {
+  using Variable = SatSolver::Variable;
+  using Literal = SatSolver::Literal;
+
+public:
+  explicit PropositionalEngine(Solver &solver)
+    : _solver(solver), _sat(), _selector(), _assumptions(), _model()
+  {
+    solver._encode_closure(_sat);
+    _select(solver._initial);
+  }
+
+  virtual ~PropositionalEngine() override {}
+
+  virtual Outcome solution() override
+  {
+    if (!_sat.solve(_assumptions))
+      return Outcome::EXHAUSTED;
+
+    _model = std::make_shared<Model>();
+    _model->states.emplace_back();
+    LTL::detail::State &state = _model->states.back();
+
+    std::vector<Literal> blocking = {SatSolver::negative(_selector)};
+    for (const auto &atom : _solver._atom_set) {
+      Variable v = static_cast<Variable>(uint64_t(atom.first));
+      if (_sat.value(v)) {
+        state.insert(LTL::detail::Literal(atom.second));
+        blocking.push_back(SatSolver::negative(v));
+      }
+
+      // The negation of an atom comes right after it, if it is there
+      if (v + 1 < _solver._number_of_formulas &&
+          _solver._bitset.negation[v + 1] &&
+          _solver._lhs[v + 1] == atom.first && _sat.value(v + 1)) {
+        state.insert(LTL::detail::Literal(atom.second, false));
+        blocking.push_back(SatSolver::negative(v + 1));
+      }
+    }
+
+    _sat.add_clause(std::move(blocking));
+
+    return Outcome::SATISFIABLE;
+  }
+
+  virtual ModelPtr model() const override { return _model; }
+
+  virtual void reset(const DynamicBitset &initial) override
+  {
+    _sat.add_clause({SatSolver::negative(_selector)});
+    _select(initial);
+  }
+
+private:
+  Solver &_solver;
+  CdclSolver _sat;
+  Variable _selector;
+  std::vector<Literal> _assumptions;
+  ModelPtr _model;
+
+  void _select(const DynamicBitset &initial)
+  {
+    _selector = _sat.new_variable();
+
+    _assumptions.clear();
+    _assumptions.push_back(SatSolver::positive(_selector));
+    for (size_t f = initial.find_first(); f != DynamicBitset::npos;
+         f = initial.find_next(f))
+      _assumptions.push_back(SatSolver::positive(static_cast<Variable>(f)));
+  }
+};
+}
+}
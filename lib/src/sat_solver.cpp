@@ -0,0 +1,570 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#include "sat_solver.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace LTL {
+namespace detail {
+
+/* Conflicts between two restarts, times the Luby sequence */
+static constexpr uint64_t RESTART_UNIT = 100;
+
+static constexpr double VARIABLE_DECAY = 0.95;
+static constexpr double CLAUSE_DECAY = 0.999;
+static constexpr double RESCALE_LIMIT = 1e100;
+
+constexpr uint32_t CdclSolver::NO_CLAUSE;
+constexpr SatSolver::Literal CdclSolver::NO_LITERAL;
+constexpr uint8_t CdclSolver::VALUE_FALSE;
+constexpr uint8_t CdclSolver::VALUE_TRUE;
+constexpr uint8_t CdclSolver::UNASSIGNED;
+
+SatSolver::~SatSolver() {}
+
+CdclSolver::CdclSolver()
+  : _ok(true),
+    _clauses(),
+    _watches(),
+    _learnts(0),
+    _maximum_learnts(1000),
+    _assigns(),
+    _phase(),
+    _level(),
+    _reason(),
+    _activity(),
+    _seen(),
+    _model(),
+    _failed(),
+    _trail(),
+    _trail_limits(),
+    _propagated(0),
+    _heap(),
+    _heap_index(),
+    _variable_increment(1),
+    _clause_increment(1),
+    _conflicts(0),
+    _decisions(0),
+    _propagations(0)
+{
+}
+
+CdclSolver::~CdclSolver() {}
+
+SatSolver::Variable CdclSolver::new_variable()
+{
+  Variable v = static_cast<Variable>(_assigns.size());
+
+  _assigns.push_back(UNASSIGNED);
+  _phase.push_back(VALUE_FALSE);
+  _level.push_back(0);
+  _reason.push_back(NO_CLAUSE);
+  _activity.push_back(0);
+  _seen.push_back(0);
+  _model.push_back(false);
+  _heap_index.push_back(-1);
+  _watches.emplace_back();
+  _watches.emplace_back();
+
+  _heap_insert(v);
+
+  return v;
+}
+
+bool CdclSolver::add_clause(std::vector<Literal> clause)
+{
+  assert(_decision_level() == 0);
+
+  if (!_ok)
+    return false;
+
+  // Drops the duplicates and the literals false from the start, and the
+  // whole clause if it is already satisfied
+  std::sort(clause.begin(), clause.end());
+  size_t size = 0;
+  for (size_t i = 0; i < clause.size(); ++i) {
+    Literal literal = clause[i];
+    assert(variable(literal) < _assigns.size());
+
+    if (_value(literal) == VALUE_TRUE ||
+        (i > 0 && literal == negate(clause[i - 1])))
+      return true;
+    if (_value(literal) == VALUE_FALSE ||
+        (size > 0 && literal == clause[size - 1]))
+      continue;
+    clause[size++] = literal;
+  }
+  clause.resize(size);
+
+  if (clause.empty())
+    return _ok = false;
+
+  if (clause.size() == 1) {
+    _assign(clause[0], NO_CLAUSE);
+    return _ok = _propagate() == NO_CLAUSE;
+  }
+
+  _attach(std::move(clause), false);
+  return true;
+}
+
+bool CdclSolver::solve(const std::vector<Literal> &assumptions)
+{
+  _failed.clear();
+  if (!_ok)
+    return false;
+
+  std::vector<Literal> learnt;
+  uint64_t restart = 0;
+  uint64_t conflicts_to_restart = RESTART_UNIT * _luby(restart);
+
+  while (true) {
+    uint32_t conflict = _propagate();
+
+    if (conflict != NO_CLAUSE) {
+      ++_conflicts;
+      if (_decision_level() == 0)
+        return _ok = false;
+
+      uint32_t backtrack_level;
+      _analyze(conflict, learnt, backtrack_level);
+      _backtrack(backtrack_level);
+
+      if (learnt.size() == 1)
+        _assign(learnt[0], NO_CLAUSE);
+      else
+        _assign(learnt[0], _attach(learnt, true));
+
+      _variable_increment /= VARIABLE_DECAY;
+      _clause_increment /= CLAUSE_DECAY;
+
+      if (conflicts_to_restart > 0)
+        --conflicts_to_restart;
+      continue;
+    }
+
+    if (conflicts_to_restart == 0) {
+      _backtrack(0);
+      if (_learnts >= _maximum_learnts)
+        _reduce_learnts();
+      conflicts_to_restart = RESTART_UNIT * _luby(++restart);
+      continue;
+    }
+
+    Literal next = NO_LITERAL;
+    while (_decision_level() < assumptions.size()) {
+      Literal assumption = assumptions[_decision_level()];
+
+      if (_value(assumption) == VALUE_TRUE)
+        _trail_limits.push_back(_trail.size());
+      else if (_value(assumption) == VALUE_FALSE) {
+        _analyze_final(assumption);
+        _backtrack(0);
+        return false;
+      }
+      else {
+        next = assumption;
+        break;
+      }
+    }
+
+    if (next == NO_LITERAL) {
+      next = _pick_branch();
+
+      if (next == NO_LITERAL) {
+        for (size_t v = 0; v < _assigns.size(); ++v)
+          _model[v] = _assigns[v] == VALUE_TRUE;
+        _backtrack(0);
+        return true;
+      }
+      ++_decisions;
+    }
+
+    _trail_limits.push_back(_trail.size());
+    _assign(next, NO_CLAUSE);
+  }
+}
+
+// Collects in _failed the given assumption, found false, and the earlier ones
+// it has been implied false by. Every decision made so far is an assumption.
+void CdclSolver::_analyze_final(Literal assumption)
+{
+  _failed.push_back(assumption);
+  if (_decision_level() == 0)
+    return;
+
+  _seen[variable(assumption)] = 1;
+
+  for (size_t i = _trail.size(); i-- > _trail_limits[0];) {
+    Variable v = variable(_trail[i]);
+    if (!_seen[v])
+      continue;
+
+    _seen[v] = 0;
+    if (_reason[v] == NO_CLAUSE) {
+      _failed.push_back(_trail[i]);
+      continue;
+    }
+
+    const std::vector<Literal> &literals = _clauses[_reason[v]].literals;
+    for (size_t k = 1; k < literals.size(); ++k)
+      if (_level[variable(literals[k])] > 0)
+        _seen[variable(literals[k])] = 1;
+  }
+
+  _seen[variable(assumption)] = 0;
+}
+
+void CdclSolver::_assign(Literal literal, uint32_t reason)
+{
+  Variable v = variable(literal);
+  assert(_assigns[v] == UNASSIGNED);
+
+  _assigns[v] = (literal & 1) ? VALUE_FALSE : VALUE_TRUE;
+  _level[v] = _decision_level();
+  _reason[v] = reason;
+  _trail.push_back(literal);
+}
+
+// Returns the conflicting clause, if any
+uint32_t CdclSolver::_propagate()
+{
+  while (_propagated < _trail.size()) {
+    Literal falsified = negate(_trail[_propagated++]);
+    std::vector<uint32_t> &watches = _watches[falsified];
+    ++_propagations;
+
+    size_t i = 0, j = 0;
+    while (i < watches.size()) {
+      uint32_t index = watches[i++];
+      std::vector<Literal> &literals = _clauses[index].literals;
+
+      if (literals[0] == falsified)
+        std::swap(literals[0], literals[1]);
+      assert(literals[1] == falsified);
+
+      if (_value(literals[0]) == VALUE_TRUE) {
+        watches[j++] = index;
+        continue;
+      }
+
+      bool moved = false;
+      for (size_t k = 2; k < literals.size(); ++k) {
+        if (_value(literals[k]) != VALUE_FALSE) {
+          std::swap(literals[1], literals[k]);
+          _watches[literals[1]].push_back(index);
+          moved = true;
+          break;
+        }
+      }
+      if (moved)
+        continue;
+
+      watches[j++] = index;
+      if (_value(literals[0]) == VALUE_FALSE) {
+        while (i < watches.size())
+          watches[j++] = watches[i++];
+        watches.resize(j);
+        _propagated = _trail.size();
+        return index;
+      }
+
+      _assign(literals[0], index);
+    }
+
+    watches.resize(j);
+  }
+
+  return NO_CLAUSE;
+}
+
+// First UIP learning. The literals implied by the others of the learnt
+// clause are then left out of it.
+void CdclSolver::_analyze(uint32_t conflict, std::vector<Literal> &learnt,
+                          uint32_t &backtrack_level)
+{
+  learnt.clear();
+  learnt.push_back(NO_LITERAL);
+
+  size_t pending = 0;
+  Literal implied = NO_LITERAL;
+  size_t index = _trail.size();
+
+  do {
+    Clause &clause = _clauses[conflict];
+    if (clause.learnt)
+      _bump_clause(clause);
+
+    for (size_t k = implied == NO_LITERAL ? 0 : 1; k < clause.literals.size();
+         ++k) {
+      Literal literal = clause.literals[k];
+      Variable v = variable(literal);
+
+      if (_seen[v] || _level[v] == 0)
+        continue;
+
+      _seen[v] = 1;
+      _bump_variable(v);
+      if (_level[v] == _decision_level())
+        ++pending;
+      else
+        learnt.push_back(literal);
+    }
+
+    while (!_seen[variable(_trail[--index])])
+      ;
+    implied = _trail[index];
+    conflict = _reason[variable(implied)];
+    _seen[variable(implied)] = 0;
+  } while (--pending > 0);
+
+  learnt[0] = negate(implied);
+
+  std::vector<Literal> marked(learnt.begin() + 1, learnt.end());
+  size_t size = 1;
+  for (size_t i = 1; i < learnt.size(); ++i) {
+    uint32_t reason = _reason[variable(learnt[i])];
+    bool redundant = reason != NO_CLAUSE;
+
+    if (redundant) {
+      const std::vector<Literal> &literals = _clauses[reason].literals;
+      for (size_t k = 1; k < literals.size(); ++k) {
+        Variable v = variable(literals[k]);
+        if (!_seen[v] && _level[v] > 0) {
+          redundant = false;
+          break;
+        }
+      }
+    }
+
+    if (!redundant)
+      learnt[size++] = learnt[i];
+  }
+  learnt.resize(size);
+
+  for (Literal literal : marked)
+    _seen[variable(literal)] = 0;
+
+  backtrack_level = 0;
+  if (learnt.size() > 1) {
+    size_t highest = 1;
+    for (size_t i = 2; i < learnt.size(); ++i)
+      if (_level[variable(learnt[i])] > _level[variable(learnt[highest])])
+        highest = i;
+
+    std::swap(learnt[1], learnt[highest]);
+    backtrack_level = _level[variable(learnt[1])];
+  }
+}
+
+void CdclSolver::_backtrack(uint32_t level)
+{
+  if (_decision_level() <= level)
+    return;
+
+  for (size_t i = _trail.size(); i > _trail_limits[level]; --i) {
+    Variable v = variable(_trail[i - 1]);
+    _phase[v] = _assigns[v];
+    _assigns[v] = UNASSIGNED;
+    _reason[v] = NO_CLAUSE;
+    _heap_insert(v);
+  }
+
+  _trail.resize(_trail_limits[level]);
+  _trail_limits.resize(level);
+  _propagated = _trail.size();
+}
+
+uint32_t CdclSolver::_attach(std::vector<Literal> literals, bool learnt)
+{
+  assert(literals.size() > 1);
+
+  uint32_t index = static_cast<uint32_t>(_clauses.size());
+  _watches[literals[0]].push_back(index);
+  _watches[literals[1]].push_back(index);
+  _clauses.push_back({std::move(literals), 0, learnt});
+
+  if (learnt) {
+    ++_learnts;
+    _bump_clause(_clauses.back());
+  }
+
+  return index;
+}
+
+SatSolver::Literal CdclSolver::_pick_branch()
+{
+  while (!_heap.empty()) {
+    Variable v = _heap_pop();
+    if (_assigns[v] == UNASSIGNED)
+      return _phase[v] == VALUE_TRUE ? positive(v) : negative(v);
+  }
+
+  return NO_LITERAL;
+}
+
+// Only called at the decision level zero, where no clause is the reason of
+// anything the analysis looks at, so that the clauses can be moved around
+void CdclSolver::_reduce_learnts()
+{
+  assert(_decision_level() == 0);
+
+  std::vector<double> activities;
+  for (const Clause &clause : _clauses)
+    if (clause.learnt && clause.literals.size() > 2)
+      activities.push_back(clause.activity);
+
+  if (activities.empty())
+    return;
+
+  auto median = activities.begin() + activities.size() / 2;
+  std::nth_element(activities.begin(), median, activities.end());
+  double threshold = *median;
+
+  size_t size = 0;
+  for (size_t i = 0; i < _clauses.size(); ++i) {
+    Clause &clause = _clauses[i];
+    if (clause.learnt && clause.literals.size() > 2 &&
+        clause.activity < threshold) {
+      --_learnts;
+      continue;
+    }
+    if (size != i)
+      _clauses[size] = std::move(clause);
+    ++size;
+  }
+  _clauses.resize(size);
+
+  for (std::vector<uint32_t> &watches : _watches)
+    watches.clear();
+  for (size_t i = 0; i < _clauses.size(); ++i) {
+    _watches[_clauses[i].literals[0]].push_back(static_cast<uint32_t>(i));
+    _watches[_clauses[i].literals[1]].push_back(static_cast<uint32_t>(i));
+  }
+
+  for (Literal literal : _trail)
+    _reason[variable(literal)] = NO_CLAUSE;
+
+  _maximum_learnts += _maximum_learnts / 10;
+}
+
+void CdclSolver::_bump_variable(Variable v)
+{
+  if ((_activity[v] += _variable_increment) > RESCALE_LIMIT) {
+    for (double &activity : _activity)
+      activity /= RESCALE_LIMIT;
+    _variable_increment /= RESCALE_LIMIT;
+  }
+
+  if (_heap_index[v] >= 0)
+    _heap_up(static_cast<size_t>(_heap_index[v]));
+}
+
+void CdclSolver::_bump_clause(Clause &clause)
+{
+  if ((clause.activity += _clause_increment) > RESCALE_LIMIT) {
+    for (Clause &other : _clauses)
+      if (other.learnt)
+        other.activity /= RESCALE_LIMIT;
+    _clause_increment /= RESCALE_LIMIT;
+  }
+}
+
+void CdclSolver::_heap_insert(Variable v)
+{
+  if (_heap_index[v] >= 0)
+    return;
+
+  _heap_index[v] = static_cast<int64_t>(_heap.size());
+  _heap.push_back(v);
+  _heap_up(_heap.size() - 1);
+}
+
+void CdclSolver::_heap_up(size_t i)
+{
+  Variable v = _heap[i];
+
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (_activity[_heap[parent]] >= _activity[v])
+      break;
+
+    _heap[i] = _heap[parent];
+    _heap_index[_heap[i]] = static_cast<int64_t>(i);
+    i = parent;
+  }
+
+  _heap[i] = v;
+  _heap_index[v] = static_cast<int64_t>(i);
+}
+
+void CdclSolver::_heap_down(size_t i)
+{
+  Variable v = _heap[i];
+
+  while (2 * i + 1 < _heap.size()) {
+    size_t child = 2 * i + 1;
+    if (child + 1 < _heap.size() &&
+        _activity[_heap[child + 1]] > _activity[_heap[child]])
+      ++child;
+    if (_activity[_heap[child]] <= _activity[v])
+      break;
+
+    _heap[i] = _heap[child];
+    _heap_index[_heap[i]] = static_cast<int64_t>(i);
+    i = child;
+  }
+
+  _heap[i] = v;
+  _heap_index[v] = static_cast<int64_t>(i);
+}
+
+SatSolver::Variable CdclSolver::_heap_pop()
+{
+  Variable top = _heap[0];
+
+  _heap[0] = _heap.back();
+  _heap_index[_heap[0]] = 0;
+  _heap.pop_back();
+  _heap_index[top] = -1;
+
+  if (!_heap.empty())
+    _heap_down(0);
+
+  return top;
+}
+
+// The i-th element of the Luby sequence 1, 1, 2, 1, 1, 2, 4, 1, ...
+uint64_t CdclSolver::_luby(uint64_t i)
+{
+  uint64_t size = 1, power = 1;
+  while (size < i + 1) {
+    size = 2 * size + 1;
+    power *= 2;
+  }
+
+  while (size - 1 != i) {
+    size = (size - 1) / 2;
+    power /= 2;
+    i %= size;
+  }
+
+  return power;
+}
+}
+}
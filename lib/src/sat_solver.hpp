@@ -0,0 +1,178 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace LTL {
+namespace detail {
+
+/*
+ * Common interface of the propositional SAT solvers. They are incremental:
+ * clauses can be added between two calls of solve(), and every call can
+ * assume some literals to be true for its own search only.
+ *
+ * Variables are numbered from zero. A literal is a variable shifted left by
+ * one, with the lowest bit set when it is negative.
+ */
+class SatSolver {
+public:
+  using Variable = uint32_t;
+  using Literal = uint32_t;
+
+  static Literal positive(Variable variable) { return variable << 1; }
+  static Literal negative(Variable variable) { return (variable << 1) | 1; }
+  static Literal negate(Literal literal) { return literal ^ 1; }
+  static Variable variable(Literal literal) { return literal >> 1; }
+
+  SatSolver() = default;
+  virtual ~SatSolver();
+
+  SatSolver(const SatSolver &) = delete;
+  SatSolver &operator=(const SatSolver &) = delete;
+
+  virtual Variable new_variable() = 0;
+  virtual size_t number_of_variables() const = 0;
+
+  // Returns false if the clauses added so far are unsatisfiable
+  virtual bool add_clause(std::vector<Literal> clause) = 0;
+
+  virtual bool solve(const std::vector<Literal> &assumptions) = 0;
+
+  // Value of a variable in the assignment found by the last solve()
+  virtual bool value(Variable variable) const = 0;
+};
+
+/*
+ * Conflict-driven clause learning solver, small enough for the propositional
+ * part of the tableau states. It has the usual ingredients: two watched
+ * literals per clause, first-UIP learning with the minimization of the learnt
+ * clause, VSIDS decisions with phase saving, Luby restarts, and the deletion
+ * of the least active half of the learnt clauses when there are too many.
+ *
+ * Assumptions are taken as the first decisions, and the learnt clauses stay
+ * valid for any later call.
+ */
+class CdclSolver : public SatSolver {
+public:
+  CdclSolver();
+  virtual ~CdclSolver() override;
+
+  virtual Variable new_variable() override;
+  virtual size_t number_of_variables() const override
+  {
+    return _assigns.size();
+  }
+
+  virtual bool add_clause(std::vector<Literal> clause) override;
+  virtual bool solve(const std::vector<Literal> &assumptions) override;
+  virtual bool value(Variable variable) const override
+  {
+    return _model[variable];
+  }
+
+  // Assumptions of the last solve() which cannot hold together, when it has
+  // returned false: empty if the clauses cannot hold by themselves
+  const std::vector<Literal> &failed_assumptions() const { return _failed; }
+
+  uint64_t conflicts() const { return _conflicts; }
+  uint64_t decisions() const { return _decisions; }
+  uint64_t propagations() const { return _propagations; }
+
+private:
+  static constexpr uint32_t NO_CLAUSE = UINT32_MAX;
+  static constexpr Literal NO_LITERAL = UINT32_MAX;
+
+  // Values of the variables, and of the literals
+  static constexpr uint8_t VALUE_FALSE = 0;
+  static constexpr uint8_t VALUE_TRUE = 1;
+  static constexpr uint8_t UNASSIGNED = 2;
+
+  struct Clause {
+    std::vector<Literal> literals; // The first two are watched
+    double activity;
+    bool learnt;
+  };
+
+  bool _ok; // False once the clauses are unsatisfiable
+
+  std::vector<Clause> _clauses;
+  std::vector<std::vector<uint32_t>> _watches; // By literal
+  size_t _learnts;
+  size_t _maximum_learnts;
+
+  /* Per variable */
+  std::vector<uint8_t> _assigns;
+  std::vector<uint8_t> _phase;
+  std::vector<uint32_t> _level;
+  std::vector<uint32_t> _reason;
+  std::vector<double> _activity;
+  std::vector<uint8_t> _seen;
+  std::vector<bool> _model;
+  std::vector<Literal> _failed;
+
+  std::vector<Literal> _trail;
+  std::vector<size_t> _trail_limits; // Where every decision level starts
+  size_t _propagated;
+
+  /* Binary max-heap of the variables by activity */
+  std::vector<Variable> _heap;
+  std::vector<int64_t> _heap_index;
+
+  double _variable_increment;
+  double _clause_increment;
+
+  uint64_t _conflicts;
+  uint64_t _decisions;
+  uint64_t _propagations;
+
+  uint8_t _value(Literal literal) const
+  {
+    uint8_t assign = _assigns[variable(literal)];
+    return assign == UNASSIGNED ? UNASSIGNED
+                                : static_cast<uint8_t>(assign ^ (literal & 1));
+  }
+
+  uint32_t _decision_level() const
+  {
+    return static_cast<uint32_t>(_trail_limits.size());
+  }
+
+  void _assign(Literal literal, uint32_t reason);
+  uint32_t _propagate();
+  void _analyze(uint32_t conflict, std::vector<Literal> &learnt,
+                uint32_t &backtrack_level);
+  void _analyze_final(Literal assumption);
+  void _backtrack(uint32_t level);
+  uint32_t _attach(std::vector<Literal> literals, bool learnt);
+  Literal _pick_branch();
+  void _reduce_learnts();
+
+  void _bump_variable(Variable variable);
+  void _bump_clause(Clause &clause);
+
+  void _heap_insert(Variable variable);
+  void _heap_up(size_t i);
+  void _heap_down(size_t i);
+  Variable _heap_pop();
+
+  static uint64_t _luby(uint64_t i);
+};
+}
+}
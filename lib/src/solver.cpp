@@ -1,16 +1,19 @@
 #include "solver.hpp"
 
 #include "ast/generator.hpp"
+#include "cube_tableau.hpp"
+#include "fair_cycle_engine.hpp"
 #include "format.hpp"
+#include "parallel_tableau.hpp"
 #include "pretty_printer.hpp"
-#include "utility.hpp"
+#include "propositional_engine.hpp"
+#include "sat_solver.hpp"
+#include "tableau.hpp"
 
+#include <algorithm>
 #include <cassert>
-#include <deque>
-
-#ifdef _MSC_VER
-#define __builtin_expect(cond, value) (cond)
-#endif
+#include <functional>
+#include <thread>
 
 namespace LTL {
 
@@ -18,53 +21,87 @@ namespace detail {
 
 namespace colors = format::colors;
 
-Solver::Solver(FormulaPtr formula, FrameID maximum_depth)
+Engine::~Engine() {}
+
+Solver::Solver(FormulaPtr formula, FrameID maximum_depth,
+               uint32_t number_of_threads)
+  : Solver(formula, {}, maximum_depth, number_of_threads)
+{
+}
+
+Solver::Solver(FormulaPtr formula, std::vector<FormulaPtr> assumptions,
+               FrameID maximum_depth, uint32_t number_of_threads)
   : _formula(formula),
+    _assumptions(std::move(assumptions)),
     _maximum_depth(maximum_depth),
+    _number_of_threads(number_of_threads),
     _state(State::UNINITIALIZED),
     _result(Result::UNDEFINED),
-    _start_index(0),
-    _loop_state(0),
+    _budget(),
+    _strategy(),
+    _cubes(),
+    _satisfiable(false),
+    _cross_by_depth_before(0),
+    _model_reported(false),
+    _depth_lower_bound(0),
+    _reported_models(),
+    _start_index(FormulaID::max()),
+    _assumption_index(),
+    _initial(),
+    _enabled_assumptions(),
     _stats(),
     _has_eventually(true),
     _has_until(true),
-    _has_release(true)
+    _has_release(true),
+    _engine()
 {
   _initialize();
 }
 
+Solver::~Solver() {}
+
 // Forward declaration
 static bool formula_ordering_func(const FormulaPtr& a, const FormulaPtr& b);
 
+static std::vector<size_t> all_assumptions(size_t count)
+{
+  std::vector<size_t> result(count);
+  for (size_t i = 0; i < count; ++i)
+    result[i] = i;
+  return result;
+}
+
 // TODO: Break this down
 void Solver::_initialize()
 {
   format::debug("Initializing solver...");
   _atom_set.clear();
 
-  /* Simplify the formula and put it in normal form */
+  /* Simplify the formulas and put them in normal form */
   format::debug("Simplifing formula...");
   Simplifier simplifier;
   _formula = simplifier.simplify(_formula);
+  for (FormulaPtr &assumption : _assumptions)
+    assumption = simplifier.simplify(assumption);
 
-  /* Generate every subformulas */
+  /* Generate every subformulas, leaving out the True and False ones */
   format::debug("Generating subformulas...");
   Generator gen;
-  gen.generate(_formula);
+  if (!isa<True>(_formula) && !isa<False>(_formula))
+    gen.generate(_formula);
+  for (const FormulaPtr &assumption : _assumptions)
+    if (!isa<True>(assumption) && !isa<False>(assumption))
+      gen.generate(assumption);
   _subformulas = gen.formulas();
 
-  /* The simplification might just have produces a True or False */
-  if (_subformulas.size() == 1) {
-    if (isa<True>(_subformulas[0])) {
-      _result = Result::SATISFIABLE;
-      _state = State::DONE;
-      return;
-    }
-    else if (isa<False>(_subformulas[0])) {
-      _result = Result::UNSATISFIABLE;
-      _state = State::DONE;
-      return;
-    }
+  _assumption_index =
+    std::vector<FormulaID>(_assumptions.size(), FormulaID::max());
+
+  /* The simplification might just have produced a True or False */
+  if (_subformulas.empty()) {
+    _number_of_formulas = 0;
+    _select_assumptions(all_assumptions(_assumptions.size()));
+    return;
   }
 
   /* Sort the subformulas in an order suitable for the computation and remove the duplicates */
@@ -92,8 +129,9 @@ void Solver::_initialize()
   _bitset.release.resize(_number_of_formulas);
   _bitset.since.resize(_number_of_formulas);
   _bitset.triggered.resize(_number_of_formulas);
+  _bitset.past.resize(_number_of_formulas);
+  _bitset.historically.resize(_number_of_formulas);
   _bitset.eventualities.resize(_number_of_formulas);
-  _bitset.temporary.resize(_number_of_formulas);
 
   _lhs = std::vector<FormulaID>(_number_of_formulas, FormulaID::max());
   _rhs = std::vector<FormulaID>(_number_of_formulas, FormulaID::max());
@@ -151,6 +189,14 @@ void Solver::_initialize()
     _add_formula_for_position(f, current_index++, lhs, rhs);
   }
 
+  for (size_t i = 0; i < _assumptions.size(); ++i) {
+    if (!isa<True>(_assumptions[i]) && !isa<False>(_assumptions[i]))
+      _assumption_index[i] = FormulaID(static_cast<uint64_t>(
+        std::lower_bound(_subformulas.begin(), _subformulas.end(),
+                         _assumptions[i], formula_ordering_func) -
+        _subformulas.begin()));
+  }
+
   /* Generate every possible eventualities beforehand and the look-up tables */
   format::debug("Generating eventualities...");
   _fw_eventualities_lut =
@@ -158,10 +204,10 @@ void Solver::_initialize()
   std::vector<FormulaPtr> eventualities;
   for (uint64_t i = 0; i < _subformulas.size(); ++i) {
     if(_bitset.eventually[i]) {
-      _bitset.eventualities[_lhs[i]] = true;
+      _bitset.eventualities.set(_lhs[i]);
       eventualities.push_back(_subformulas[_lhs[i]]);
     } else if(_bitset.until[i]) {
-      _bitset.eventualities[_rhs[i]] = true;
+      _bitset.eventualities.set(_rhs[i]);
       eventualities.push_back(_subformulas[_rhs[i]]);
     }
   }
@@ -188,102 +234,422 @@ void Solver::_initialize()
       format::verbose("- {}", p.to_string(_subformulas[i]));
   }
 
+  /* Precompute the deterministic part of the expansion of every formula */
+  _build_alpha_closure();
+
   /* We are now ready to start the computation */
   _has_eventually = _bitset.eventually.any();
   _has_until = _bitset.until.any();
   _has_release = _bitset.release.any();
 
-  _stack.push(Frame(FrameID(0), _start_index, _number_of_formulas,
-                    _bw_eventualities_lut.size()));
-  _state = State::INITIALIZED;
+  _select_assumptions(all_assumptions(_assumptions.size()));
+  _make_engine();
 
   format::debug("Solver initialized!");
 }
 
+// Sets up the initial state for the formula and the given assumptions. The
+// search is only needed if the result isn't already known from them.
+void Solver::_select_assumptions(const std::vector<size_t> &assumptions)
+{
+  _state = State::INITIALIZED;
+  _result = Result::UNDEFINED;
+  _satisfiable = false;
+  _cross_by_depth_before = _stats.cross_by_depth;
+  _model_reported = false;
+  _reported_models.clear();
+  _enabled_assumptions = assumptions;
+
+  bool unsatisfiable = isa<False>(_formula);
+
+  _initial = DynamicBitset(_number_of_formulas);
+  if (_start_index != FormulaID::max())
+    _initial.set(_start_index);
+
+  for (size_t i : assumptions) {
+    assert(i < _assumptions.size());
+    if (isa<False>(_assumptions[i]))
+      unsatisfiable = true;
+    else if (_assumption_index[i] != FormulaID::max())
+      _initial.set(_assumption_index[i]);
+  }
+
+  if (unsatisfiable) {
+    _result = Result::UNSATISFIABLE;
+    _state = State::DONE;
+  }
+  else if (_initial.none()) {
+    _result = Result::SATISFIABLE;
+    _state = State::DONE;
+  }
+}
+
+// The closure of a formula is the formula itself plus, for conjunctions,
+// the closures of both sides and, for always formulas, the closure of the
+// argument and the tomorrow formula which carries it on. Nested conjunctions
+// are thus flattened, and the state a frame reaches by expanding all of its
+// conjunction and always formulas is a single OR of their closures.
+void Solver::_build_alpha_closure()
+{
+  _alpha_closure = std::vector<DynamicBitset>(
+    _number_of_formulas, DynamicBitset(_number_of_formulas));
+  DynamicBitset done(_number_of_formulas);
+
+  std::function<void(uint64_t)> build = [&](uint64_t i) {
+    if (done[i])
+      return;
+
+    DynamicBitset &closure = _alpha_closure[i];
+    closure.set(i);
+
+    if (_bitset.conjunction[i]) {
+      build(_lhs[i]);
+      build(_rhs[i]);
+      closure |= _alpha_closure[_lhs[i]];
+      closure |= _alpha_closure[_rhs[i]];
+    }
+    else if (_bitset.always[i]) {
+      assert(_bitset.tomorrow[i + 1] && _lhs[i + 1] == FormulaID(i));
+      build(_lhs[i]);
+      closure |= _alpha_closure[_lhs[i]];
+      closure.set(i + 1);
+    }
+
+    done.set(i);
+  };
+
+  for (uint64_t i = 0; i < _number_of_formulas; ++i)
+    build(i);
+}
+
+template <typename Bitset>
+static std::unique_ptr<Engine> make_tableau(Solver &solver,
+                                            uint32_t number_of_threads,
+                                            const Solver::Cubes &cubes)
+{
+  if (cubes.depth > 0)
+    return std::make_unique<CubeTableau<Bitset>>(solver);
+
+  if (number_of_threads > 1)
+    return std::make_unique<ParallelTableau<Bitset>>(solver,
+                                                     number_of_threads);
+
+  return std::make_unique<Tableau<Bitset>>(solver);
+}
+
+/*
+ * Picks the narrowest bitset able to hold the closure. Most formulas fit in
+ * a few hundred subformulas, and with a fixed width every frame is allocated
+ * in one piece and every bitset operation is unrolled.
+ *
+ * Zero threads means one per hardware thread. When the search is split into
+ * cubes, the workers are processes instead, and the threads are not used.
+ *
+ * Formulas without temporal operators, and the ones in the shape of GR(1)
+ * specifications searched as they come, have engines of their own, which use
+ * neither.
+ */
+void Solver::_make_engine()
+{
+  if (_number_of_threads == 0)
+    _number_of_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  if (_is_propositional())
+    _engine = std::make_unique<PropositionalEngine>(*this);
+  else if (_uses_fair_cycle_engine()) {
+    _engine = std::make_unique<FairCycleEngine>(*this);
+    format::debug("Using the fair-cycle engine");
+  }
+  else
+    _engine = _make_tableau();
+}
+
+std::unique_ptr<Engine> Solver::_make_tableau()
+{
+  size_t blocks = blocks_for(_number_of_formulas);
+
+  format::debug("Using {} bitset blocks per frame", blocks);
+  if (_cubes.depth > 0)
+    format::debug("Splitting into cubes at {} choices", _cubes.depth);
+  else
+    format::debug("Using {} threads", _number_of_threads);
+
+  if (blocks <= 1)
+    return make_tableau<FixedBitset<1>>(*this, _number_of_threads, _cubes);
+  if (blocks <= 2)
+    return make_tableau<FixedBitset<2>>(*this, _number_of_threads, _cubes);
+  if (blocks <= 4)
+    return make_tableau<FixedBitset<4>>(*this, _number_of_threads, _cubes);
+  if (blocks <= 8)
+    return make_tableau<FixedBitset<8>>(*this, _number_of_threads, _cubes);
+  if (blocks <= 16)
+    return make_tableau<FixedBitset<16>>(*this, _number_of_threads, _cubes);
+  return make_tableau<DynamicBitset>(*this, _number_of_threads, _cubes);
+}
+
+// The fair-cycle engine knows nothing of depths, threads, cubes or tableau
+// rules, so asking for any of them leaves the formula to the tableau
+bool Solver::_uses_fair_cycle_engine() const
+{
+  const Strategy strategy;
+
+  return _maximum_depth >= FrameID::max() && _number_of_threads == 1 &&
+         _cubes.depth == 0 && _strategy.rules == strategy.rules &&
+         _strategy.branching == strategy.branching &&
+         _strategy.second_alternative_first ==
+           strategy.second_alternative_first &&
+         _strategy.lookahead == strategy.lookahead &&
+         _strategy.restarts == strategy.restarts && _is_gr1();
+}
+
+void Solver::set_strategy(const Strategy &strategy)
+{
+  bool fair_cycle = _uses_fair_cycle_engine();
+  _strategy = strategy;
+
+  if (_state == State::INITIALIZED && fair_cycle != _uses_fair_cycle_engine())
+    _make_engine();
+}
+
+void Solver::set_cubes(const Cubes &cubes)
+{
+  if (cubes.depth == _cubes.depth && cubes.workers == _cubes.workers)
+    return;
+
+  _cubes = cubes;
+
+  if (_state == State::INITIALIZED)
+    _make_engine();
+}
+
+bool Solver::_is_propositional() const
+{
+  return _bitset.tomorrow.none() && _bitset.yesterday.none() &&
+         _bitset.always.none() && _bitset.eventually.none() &&
+         _bitset.until.none() && _bitset.release.none() &&
+         _bitset.since.none() && _bitset.triggered.none() &&
+         _bitset.past.none() && _bitset.historically.none();
+}
+
+// Formulas about the current state and the next ones only
+static bool is_local(const FormulaPtr &formula)
+{
+  switch (formula->type()) {
+    case Formula::Type::Atom:
+      return true;
+    case Formula::Type::Negation:
+      return isa<Atom>(fast_cast<Negation>(formula)->formula());
+    case Formula::Type::Tomorrow:
+      return is_local(fast_cast<Tomorrow>(formula)->formula());
+    case Formula::Type::Conjunction:
+      return is_local(fast_cast<Conjunction>(formula)->left()) &&
+             is_local(fast_cast<Conjunction>(formula)->right());
+    case Formula::Type::Disjunction:
+      return is_local(fast_cast<Disjunction>(formula)->left()) &&
+             is_local(fast_cast<Disjunction>(formula)->right());
+    default:
+      return false;
+  }
+}
+
+// Boolean combinations of local formulas and eventually formulas of local
+// ones, as in the responses G (p -> F q)
+static bool is_response(const FormulaPtr &formula, bool &fair)
+{
+  if (isa<Conjunction>(formula))
+    return is_response(fast_cast<Conjunction>(formula)->left(), fair) &&
+           is_response(fast_cast<Conjunction>(formula)->right(), fair);
+
+  if (isa<Disjunction>(formula))
+    return is_response(fast_cast<Disjunction>(formula)->left(), fair) &&
+           is_response(fast_cast<Disjunction>(formula)->right(), fair);
+
+  if (isa<Eventually>(formula)) {
+    fair = true;
+    return is_local(fast_cast<Eventually>(formula)->formula());
+  }
+
+  return is_local(formula);
+}
+
+// Conjunctions of responses, always formulas and eventually always formulas
+// of such conjunctions. Tells whether there is any fairness, persistence or
+// response to look after.
+static bool is_gr1(const FormulaPtr &formula, bool &fair)
+{
+  if (isa<Conjunction>(formula))
+    return is_gr1(fast_cast<Conjunction>(formula)->left(), fair) &&
+           is_gr1(fast_cast<Conjunction>(formula)->right(), fair);
+
+  if (isa<Always>(formula))
+    return is_gr1(fast_cast<Always>(formula)->formula(), fair);
+
+  if (isa<Eventually>(formula)) {
+    const FormulaPtr &argument = fast_cast<Eventually>(formula)->formula();
+    if (isa<Always>(argument)) {
+      fair = true;
+      return is_gr1(fast_cast<Always>(argument)->formula(), fair);
+    }
+  }
+
+  return is_response(formula, fair);
+}
+
+// Formulas left to the FairCycleEngine: GR(1) specifications, with some
+// fairness condition or persistent formula, as the others are better off
+// with the tableau
+bool Solver::_is_gr1() const
+{
+  bool fair = false;
+
+  if (!isa<True>(_formula) && !is_gr1(_formula, fair))
+    return false;
+
+  for (const FormulaPtr &assumption : _assumptions)
+    if (!isa<True>(assumption) && !isa<False>(assumption) &&
+        !is_gr1(assumption, fair))
+      return false;
+
+  return fair;
+}
+
+// The propositional part of the expansion rules, with a variable for every
+// formula of the closure: each formula implies what either of its tableau
+// alternatives adds, where tomorrow formulas are left free, and clashes with
+// its negation. A set of formulas has an expansion free of contradictions if
+// and only if the clauses are satisfiable with its variables set.
+void Solver::_encode_closure(SatSolver &sat) const
+{
+  using Literal = SatSolver::Literal;
+
+  auto positive = [](uint64_t f) {
+    return SatSolver::positive(static_cast<SatSolver::Variable>(f));
+  };
+  auto negative = [](uint64_t f) {
+    return SatSolver::negative(static_cast<SatSolver::Variable>(f));
+  };
+
+  // The tomorrow formula carrying on a temporal one
+  auto tomorrow = [&](uint64_t f) {
+    return _bitset.tomorrow[f + 1] && _lhs[f + 1] == FormulaID(f) ? f + 1
+                                                                  : f + 2;
+  };
+
+  while (sat.number_of_variables() < _number_of_formulas)
+    sat.new_variable();
+
+  for (uint64_t f = 0; f < _number_of_formulas; ++f) {
+    Literal absent = negative(f);
+
+    if (_bitset.conjunction[f]) {
+      sat.add_clause({absent, positive(_lhs[f])});
+      sat.add_clause({absent, positive(_rhs[f])});
+    }
+    else if (_bitset.always[f]) {
+      sat.add_clause({absent, positive(_lhs[f])});
+      sat.add_clause({absent, positive(f + 1)});
+    }
+    else if (_bitset.disjunction[f])
+      sat.add_clause({absent, positive(_lhs[f]), positive(_rhs[f])});
+    else if (_bitset.eventually[f])
+      sat.add_clause({absent, positive(_lhs[f]), positive(f + 1)});
+    else if (_bitset.until[f]) {
+      sat.add_clause({absent, positive(_rhs[f]), positive(_lhs[f])});
+      sat.add_clause({absent, positive(_rhs[f]), positive(tomorrow(f))});
+    }
+    else if (_bitset.release[f]) {
+      sat.add_clause({absent, positive(_rhs[f])});
+      sat.add_clause({absent, positive(_lhs[f]), positive(tomorrow(f))});
+    }
+    else if (_bitset.negation[f])
+      sat.add_clause({absent, negative(_lhs[f])});
+  }
+}
+
 // TODO: The logic in this can be simplified
 void Solver::_add_formula_for_position(const FormulaPtr &formula, FormulaID position, FormulaID lhs, FormulaID rhs)
 {
   switch (formula->type()) {
     case Formula::Type::Atom:
-      _bitset.atom[position] = true;
+      _bitset.atom.set(position);
       _atom_set[position] = fast_cast<Atom>(formula)->name();
       break;
 
     case Formula::Type::Negation:
       if (isa<Until>(fast_cast<Negation>(formula)->formula())) {
-        _bitset.release[position] = true;
+        _bitset.release.set(position);
         _lhs[position] = lhs;
         _rhs[position] = rhs;
         break;
       }
-      _bitset.negation[position] = true;
+      _bitset.negation.set(position);
       _lhs[position] = lhs;
       break;
 
     case Formula::Type::Tomorrow:
-      _bitset.tomorrow[position] = true;
+      _bitset.tomorrow.set(position);
       _lhs[position] = lhs;
       break;
 
     case Formula::Type::Yesterday:
-      _bitset.yesterday[position] = true;
+      _bitset.yesterday.set(position);
       _lhs[position] = lhs;
       break;
 
     case Formula::Type::Always:
-      _bitset.always[position] = true;
+      _bitset.always.set(position);
       _lhs[position] = lhs;
       break;
 
     case Formula::Type::Eventually:
-      _bitset.eventually[position] = true;
+      _bitset.eventually.set(position);
       _lhs[position] = lhs;
       break;
 
     case Formula::Type::Conjunction:
-      _bitset.conjunction[position] = true;
+      _bitset.conjunction.set(position);
       _lhs[position] = lhs;
       _rhs[position] = rhs;
       break;
 
     case Formula::Type::Disjunction:
-      _bitset.disjunction[position] = true;
+      _bitset.disjunction.set(position);
       _lhs[position] = lhs;
       _rhs[position] = rhs;
       break;
 
     case Formula::Type::Until:
-      _bitset.until[position] = true;
+      _bitset.until.set(position);
       _lhs[position] = lhs;
       _rhs[position] = rhs;
       break;
 
     case Formula::Type::Release:
-      _bitset.release[position] = true;
+      _bitset.release.set(position);
       _lhs[position] = lhs;
       _rhs[position] = rhs;
       break;
 
     case Formula::Type::Since:
-      _bitset.since[position] = true;
+      _bitset.since.set(position);
       _lhs[position] = lhs;
       _rhs[position] = rhs;
       break;
 
     case Formula::Type::Triggered:
-      _bitset.triggered[position] = true;
+      _bitset.triggered.set(position);
       _lhs[position] = lhs;
       _rhs[position] = rhs;
       break;
 
     case Formula::Type::Past:
-      _bitset.past[position] = true;
+      _bitset.past.set(position);
       _lhs[position] = lhs;
       _rhs[position] = rhs;
       break;
 
     case Formula::Type::Historically:
-      _bitset.historically[position] = true;
+      _bitset.historically.set(position);
       _lhs[position] = lhs;
       _rhs[position] = rhs;
       break;
@@ -297,464 +663,233 @@ void Solver::_add_formula_for_position(const FormulaPtr &formula, FormulaID posi
   }
 }
 
-bool Solver::_check_contradiction_rule()
-{
-  const Frame &frame = _stack.top();
-
-  _bitset.temporary = frame.formulas;
-  _bitset.temporary &= _bitset.negation;
-  _bitset.temporary >>= 1;
-  _bitset.temporary &= frame.formulas;
-  return _bitset.temporary.any();
-}
-
-// TODO: extract every conjunction, even when nested
-bool Solver::_apply_conjunction_rule()
-{
-  Frame &frame = _stack.top();
-  _bitset.temporary = frame.formulas;
-  _bitset.temporary &= _bitset.conjunction;
-  _bitset.temporary &= frame.to_process;
-
-  if (!_bitset.temporary.any())
-    return false;
-
-  // TODO: find_first and find_next don't use __builtin_clz/__builtin_ctz, find
-  // if a custom implementation using them is faster
-  size_t one = _bitset.temporary.find_first();
-  while (one != Bitset::npos) {
-    assert(_bitset.conjunction[one]);
-    assert(frame.formulas[one]);
-    assert(frame.to_process[one]);
-
-    frame.formulas[_lhs[one]] = true;
-    frame.formulas[_rhs[one]] = true;
-    frame.to_process[one] = false;
-    one = _bitset.temporary.find_next(one);
-  }
-
-  return true;
-}
-
-bool Solver::_apply_always_rule()
-{
-  Frame &frame = _stack.top();
-  _bitset.temporary = frame.formulas;
-  _bitset.temporary &= _bitset.always;
-  _bitset.temporary &= frame.to_process;
-
-  if (!_bitset.temporary.any())
-    return false;
-
-  size_t one = _bitset.temporary.find_first();
-  while (one != Bitset::npos) {
-    assert(_bitset.always[one]);
-    assert(frame.formulas[one]);
-    assert(frame.to_process[one]);
-
-    frame.formulas[_lhs[one]] = true;
-    assert(_bitset.tomorrow[one + 1] && _lhs[one + 1] == FormulaID(one));
-    frame.formulas[one + 1] = true;
-    frame.to_process[one] = false;
-    one = _bitset.temporary.find_next(one);
-  }
-
-  return true;
-}
-
-#define DEFINE_DISJUNCTIVE_RULE(rule)            \
-  bool Solver::_apply_##rule##_rule()            \
-  {                                              \
-    Frame &frame = _stack.top();                 \
-    _bitset.temporary = frame.formulas;          \
-    _bitset.temporary &= _bitset.rule;           \
-    _bitset.temporary &= frame.to_process;       \
-                                                 \
-    size_t one = _bitset.temporary.find_first(); \
-    if (one != Bitset::npos) {                   \
-      assert(_bitset.rule[one]);                 \
-      assert(frame.formulas[one]);               \
-      assert(frame.to_process[one]);             \
-                                                 \
-      frame.to_process[one] = false;             \
-      frame.choosen_formula = FormulaID(one);    \
-      frame.type = Frame::CHOICE;                \
-      return true;                               \
-    }                                            \
-                                                 \
-    return false;                                \
-  }
-
-DEFINE_DISJUNCTIVE_RULE(disjunction)
-DEFINE_DISJUNCTIVE_RULE(eventually)
-DEFINE_DISJUNCTIVE_RULE(until)
-DEFINE_DISJUNCTIVE_RULE(release)
-
-#undef DEFINE_DISJUNCTIVE_RULE
-
+/*
+ * A search exhausted after cutting some branch at the maximum depth only
+ * proves that there is no model within that depth, so its result is
+ * UNDEFINED rather than UNSATISFIABLE.
+ */
 Solver::Result Solver::solution()
 {
   if (_state == State::RUNNING || _state == State::DONE)
     return _result;
 
-  if (_state == State::PAUSED)
-    _rollback_to_latest_choice();
-
   _state = State::RUNNING;
-  bool rules_applied;
-
-loop:
-  while (!_stack.empty()) {
-    Frame &frame = _stack.top();
-
-    rules_applied = true;
-    while (rules_applied) {
-      rules_applied = false;
-
-      if (__builtin_expect(frame.formulas.none(), 0)) {
-        _state = State::PAUSED;
-        _result = Result::SATISFIABLE;
-        _loop_state = frame.chain->id;
-
-		    _print_stats();
-
-        return _result;
-      }
-
-      if (_check_contradiction_rule()) {
-        _rollback_to_latest_choice();
-        ++_stats.total_frames;
-        ++_stats.cross_by_contradiction;
-        goto loop;
-      }
-
-      if (_apply_conjunction_rule())
-        rules_applied = true;
-      if (_apply_always_rule())
-        rules_applied = true;
-
-      if (_apply_disjunction_rule()) {
-        Frame new_frame(frame);
-        new_frame.formulas[_lhs[frame.choosen_formula]] = true;
-        _stack.push(std::move(new_frame));
 
-        ++_stats.total_frames;
-        _stats.maximum_frames = std::max(
-          _stats.maximum_frames, static_cast<uint64_t>(_stack.size()));
-
-        goto loop;
-      }
-
-	  // TODO: Don't generate eventualities here at all
-      if (_has_eventually && _apply_eventually_rule()) {
-        FormulaID req = _lhs[frame.choosen_formula];
-
-        assert(_bitset.eventualities[req]);
-        frame.requests[req] = true;
-
-        Frame new_frame(frame);
-        new_frame.formulas[req] = true;
-        _stack.push(std::move(new_frame));
-
-        ++_stats.total_frames;
-        _stats.maximum_frames = std::max(_stats.maximum_frames,
-                                         static_cast<uint64_t>(_stack.size()));
-
-        goto loop;
-      }
-
-      if (_has_until && _apply_until_rule())
-	    {
-        FormulaID req = _rhs[frame.choosen_formula];
-
-        assert(_bitset.eventualities[req]);
-        frame.requests[req] = true;
-
-        Frame new_frame(frame);
-        new_frame.formulas[req] = true;
-        _stack.push(std::move(new_frame));
-
-        ++_stats.total_frames;
-        _stats.maximum_frames = std::max(_stats.maximum_frames,
-                                         static_cast<uint64_t>(_stack.size()));
-
-        goto loop;
-      }
-
-      if (_has_release && _apply_release_rule())
-	  {
-        Frame new_frame(frame);
-        new_frame.formulas[_lhs[frame.choosen_formula]] = true;
-        new_frame.formulas[_rhs[frame.choosen_formula]] = true;
-        _stack.push(std::move(new_frame));
-
-        ++_stats.total_frames;
-        _stats.maximum_frames = std::max(_stats.maximum_frames,
-                                         static_cast<uint64_t>(_stack.size()));
-
-        goto loop;
-      }
-
-      if (rules_applied)
-        goto loop;
-    }
-
-    _update_eventualities_satisfaction();
-    _update_history();
-
-    bool loop_result = false;
-
-    std::tie(loop_result, _loop_state) = _check_loop_rule();
-    if (loop_result)
-	  {
-      _result = Result::SATISFIABLE;
+  switch (_engine->solution()) {
+    case Engine::Outcome::SATISFIABLE:
       _state = State::PAUSED;
+      _result = Result::SATISFIABLE;
+      _satisfiable = true;
+      _model_reported = false;
+      break;
 
-	    _print_stats();
-      __dump_current_branch();
-
-      return _result;
-    }
-
-    if (_check_prune0_rule() || _check_prune_rule())
-	  {
-      _rollback_to_latest_choice();
-      ++_stats.total_frames;
-      ++_stats.cross_by_prune;
-
-      goto loop;
-    }
-
-    if (frame.id >= _maximum_depth)
-	{
-      _rollback_to_latest_choice();
-      ++_stats.total_frames;
-      goto loop;
-    }
-
-    Frame new_frame(frame.id + 1, _number_of_formulas, frame.eventualities,
-                    &frame);
-    _bitset.temporary = frame.formulas;
-    _bitset.temporary &= _bitset.tomorrow;
-
-    for (uint64_t i = 0; i < _number_of_formulas; ++i) {
-      if (_bitset.temporary[i]) {
-        assert(frame.formulas[i]);
-        assert(_bitset.tomorrow[i]);
-        new_frame.formulas[_lhs[i]] = true;
-      }
-    }
-
-    frame.type = Frame::STEP;
-
-    _stack.push(std::move(new_frame));
-    ++_stats.total_frames;
-    ++_stats.total_steps;
+    case Engine::Outcome::INTERRUPTED:
+    case Engine::Outcome::CANCELLED:
+      _state = State::PAUSED;
+      _result = Result::UNDEFINED;
+      format::debug("Search interrupted, out of budget");
+      break;
 
-    _stats.maximum_model_size = std::max(
-      _stats.maximum_model_size, static_cast<uint64_t>(_stack.top().id));
+    case Engine::Outcome::EXHAUSTED:
+      _state = State::DONE;
+      if (_satisfiable)
+        _result = Result::SATISFIABLE;
+      else if (_stats.cross_by_depth > _cross_by_depth_before)
+        _result = Result::UNDEFINED;
+      else
+        _result = Result::UNSATISFIABLE;
+      break;
   }
 
-  _state = State::DONE;
-  if (_result == Result::UNDEFINED)
-    _result = Result::UNSATISFIABLE;
-
   _print_stats();
 
   return _result;
 }
 
-void Solver::_update_eventualities_satisfaction()
+Solver::Result Solver::solve(const std::vector<size_t> &assumptions)
 {
-  Frame &frame = _stack.top();
+  if (_state == State::UNINITIALIZED || _state == State::RUNNING)
+    return _result;
 
-  uint64_t i = 0;
-  for(Eventuality &ev : frame.eventualities) {
-    if (frame.formulas[_bw_eventualities_lut[i]])
-      ev.set_satisfied(frame.id);
-    ++i;
-  }
+  _select_assumptions(assumptions);
+  if (_state == State::DONE)
+    return _result;
+
+  _engine->reset(_initial);
+
+  return solution();
 }
 
-void Solver::_update_history()
+ModelPtr Solver::model()
 {
-  Frame *current_frame = _stack.top().chain;
-  Frame &top_frame = _stack.top();
+  if (_state != State::PAUSED)
+    return nullptr;
 
-  while (current_frame) {
-    if (current_frame->formulas == top_frame.formulas) {
-      top_frame.prev = current_frame;
-      top_frame.first = current_frame->first;
-      return;
-    }
+  if (_result == Result::UNSATISFIABLE || _result == Result::UNDEFINED)
+    return nullptr;
 
-    current_frame = current_frame->chain;
+  if (!_engine) {
+    assert(_subformulas.empty());
+    ModelPtr model = std::make_shared<Model>();
+    model->loop_state = 0;
+    model->states.push_back({Literal(u8"\u22a4")});
+    return model;
   }
 
-  top_frame.prev = &top_frame;
-  top_frame.first = &top_frame;
+  return _engine->model();
 }
 
-std::pair<bool, FrameID> Solver::_check_loop_rule() const
+// Brings a model to the shortest form of the word it stands for: the loop
+// is cut to its smallest period, then rolled back over the states before it
+// which repeat its last one
+static void minimize(Model &model)
 {
-  const Frame &frame = _stack.top();
+  std::vector<State> &states = model.states;
+  size_t start = model.loop_state;
+  size_t length = states.size() - start;
 
-  if (frame.first == &frame)
-    return std::make_pair(false, FrameID(0));
-
-  size_t i = 0;
-  bool ret =
-    std::all_of(frame.eventualities.begin(), frame.eventualities.end(),
-      [&](Eventuality ev) {
-        return !frame.requests[_bw_eventualities_lut[i++]] ||
-          (ev.is_satisfied() && ev.id() >= frame.first->id);
-      }
-    );
-
-  return std::make_pair(ret, frame.first->id);
-}
+  for (size_t period = 1; period < length; ++period) {
+    if (length % period != 0)
+      continue;
 
-bool Solver::_check_prune0_rule() const
-{
-  const Frame &frame = _stack.top();
+    size_t i = start;
+    while (i + period < states.size() && states[i] == states[i + period])
+      ++i;
 
-  if (frame.prev == &frame)
-    return false;
+    if (i + period == states.size()) {
+      states.resize(start + period);
+      break;
+    }
+  }
 
-  size_t i = 0;
-  return
-    std::none_of(frame.eventualities.begin(), frame.eventualities.end(),
-      [&](Eventuality ev) {
-        if (!frame.requests[_bw_eventualities_lut[i++]])
-          return false;
+  while (start > 0 && states[start - 1] == states.back()) {
+    states.pop_back();
+    --start;
+  }
 
-        return ev.is_satisfied() && ev.id() > frame.prev->id;
-      }
-    );
+  model.loop_state = start;
 }
 
-bool Solver::_check_prune_rule() const
+static uint64_t hash_model(const Model &model)
 {
-  const Frame &frame = _stack.top();
+  std::hash<std::string> hash_atom;
 
-  if (frame.prev == frame.first)
-    return false;
+  uint64_t result = mix64(model.loop_state);
+  for (const State &state : model.states) {
+    for (const Literal &literal : state)
+      result = mix64(result ^ hash_atom(literal.atom()) ^ literal.positive());
+    result = mix64(result + 1);
+  }
 
-  size_t i = 0;
-  return
-    std::all_of(frame.eventualities.begin(), frame.eventualities.end(),
-    [&](Eventuality ev) {
-      if (!frame.requests[_bw_eventualities_lut[i]])
-        return true;
-
-      assert(frame.prev->first == frame.first);
-      bool ret =
-        !(ev.is_satisfied() && ev.id() >= frame.prev->id)
-           || (frame.prev->eventualities[i].is_satisfied() &&
-               frame.prev->eventualities[i].id() >= frame.first->id);
-      ++i;
-      return ret;
-    });
+  return result;
 }
 
-// This is probably not updating the solver stats correctly (what happens when
-// we pop a STEP frame?)
-void Solver::_rollback_to_latest_choice()
+ModelPtr Solver::next_model()
 {
-  while (!_stack.empty()) {
-    if (_stack.top().type == Frame::CHOICE &&
-        _stack.top().choosen_formula != FormulaID::max()) {
-      Frame &top = _stack.top();
-      ;
-      Frame new_frame(top);
-
-      if (_bitset.disjunction[top.choosen_formula])
-        new_frame.formulas[_rhs[top.choosen_formula]] = true;
-      else if (_bitset.eventually[top.choosen_formula]) {
-        new_frame.formulas[top.choosen_formula + 1] = true;
-        assert(_bitset.tomorrow[top.choosen_formula + 1] &&
-               _lhs[top.choosen_formula + 1] == top.choosen_formula);
-      }
-      else if (_bitset.until[top.choosen_formula]) {
-        new_frame.formulas[_lhs[top.choosen_formula]] = true;
-        if (_bitset.tomorrow[top.choosen_formula + 1]) {
-          new_frame.formulas[top.choosen_formula + 1] = true;
-          assert(_lhs[top.choosen_formula + 1] == top.choosen_formula);
-        }
-        else {
-          new_frame.formulas[top.choosen_formula + 2] = true;
-          assert(_lhs[top.choosen_formula + 2] == top.choosen_formula);
-        }
-      }
-      else if (_bitset.release[top.choosen_formula])
-      {
-        new_frame.formulas[_rhs[top.choosen_formula]] = true;
-        if (_bitset.tomorrow[top.choosen_formula + 1]) {
-			if (_lhs[top.choosen_formula + 1] == top.choosen_formula)
-				new_frame.formulas[top.choosen_formula + 1] = true;
-			else
-				new_frame.formulas[top.choosen_formula + 2] = true;
-        }
-        else {
-          new_frame.formulas[top.choosen_formula + 2] = true;
-          assert(_lhs[top.choosen_formula + 2] == top.choosen_formula);
-        }
-      }
-      else
-        assert(false);
+  while (true) {
+    if (_state != State::PAUSED || _result != Result::SATISFIABLE ||
+        _model_reported) {
+      if (solution() != Result::SATISFIABLE || _state != State::PAUSED)
+        return nullptr;
+    }
+    _model_reported = true;
 
-      top.choosen_formula = FormulaID::max();
-      _stack.push(std::move(new_frame));
+    ModelPtr model = _engine->model();
+    minimize(*model);
 
-      return;
-    }
+    uint64_t hash = hash_model(*model);
+    auto same = _reported_models.equal_range(hash);
+    bool reported = std::any_of(same.first, same.second, [&](auto const &m) {
+      return m.second->loop_state == model->loop_state &&
+             m.second->states == model->states;
+    });
 
-    _stack.pop();
+    if (!reported) {
+      _reported_models.emplace(hash, model);
+      return model;
+    }
   }
 }
 
-ModelPtr Solver::model()
+// The first round looks for any model, to have one at hand early. The next
+// ones start over from the initial state with a doubling depth limit, and
+// each one exhausted without a model raises the lower bound. They keep the
+// nogood cache, which is not affected by the depth limit as the frames cut by
+// it never end up there. Models found deeper than the limit, from frames
+// pushed before it was tightened, are skipped.
+ModelPtr Solver::shortest_model()
 {
-  if (_state != State::PAUSED)
+  if (_state == State::UNINITIALIZED || _state == State::RUNNING)
     return nullptr;
 
-  if (_result == Result::UNSATISFIABLE || _result == Result::UNDEFINED)
-    return nullptr;
+  const FrameID maximum_depth = _maximum_depth;
+  ModelPtr shortest = nullptr;
+  FrameID bound = maximum_depth; // Of the models still worth looking for
+  FrameID limit = maximum_depth; // Of the current round
+  bool first_round = true;
+  bool proven = false;
+
+  // The rounds have a maximum depth, which only the tableau knows about, so
+  // an engine without one is set aside for the search and given back after
+  std::unique_ptr<Engine> unbounded;
+  if (_uses_fair_cycle_engine()) {
+    unbounded = std::move(_engine);
+    _engine = _make_tableau();
+  }
 
-  ModelPtr model = std::make_shared<Model>();
+  _depth_lower_bound = FrameID(1);
 
-  if (_subformulas.size() == 1 && isa<True>(_subformulas[0])) {
-    model->loop_state = 0;
-    model->states.push_back({Literal(u8"\u22a4")});
-    return model;
-  }
+  while (!(proven = _depth_lower_bound > bound)) {
+    _select_assumptions(std::vector<size_t>(_enabled_assumptions));
+    if (_state == State::DONE)
+      break;
 
-  uint64_t i = 0;
-  for (const auto &frame : Container(_stack)) {
-    if (frame.type == Frame::CHOICE)
-      continue;
+    _engine->reset(_initial);
+    _maximum_depth = std::min(limit, bound);
 
-    LTL::detail::State state;
-    for (uint64_t j = 0; j < _number_of_formulas; ++j) {
-      if (frame.formulas[j]) {
-        if (_atom_set.find(FormulaID(j)) != _atom_set.end())
-          state.insert(Literal(_atom_set.find(FormulaID(j))->second));
-        else if (_bitset.negation[j] &&
-                 _atom_set.find(_lhs[j]) != _atom_set.end())
-          state.insert(
-            Literal(_atom_set.find(FormulaID(_lhs[j]))->second, false));
-      }
+    while (solution() == Result::SATISFIABLE && _state == State::PAUSED) {
+      ModelPtr model = _engine->model();
+      FrameID size(static_cast<int64_t>(model->states.size()));
+      if (size > _maximum_depth)
+        continue;
+
+      shortest = model;
+      bound = size - 1;
+      _maximum_depth = bound;
+
+      if (first_round)
+        break;
+    }
+
+    if (first_round) {
+      if (!shortest)
+        break;
+      first_round = false;
+      limit = FrameID(1);
+      continue;
     }
 
-    model->states.push_back(state);
-    ++i;
+    if (_state != State::DONE)
+      break;
+
+    _depth_lower_bound = _maximum_depth + 1;
+
+    int64_t doubled = limit;
+    limit = doubled > maximum_depth / 2 ? maximum_depth : FrameID(doubled * 2);
   }
 
-  if (_stack.top().id != 0)
-    model->states.pop_back();
-  model->loop_state = _loop_state;
+  _maximum_depth = maximum_depth;
+  if (unbounded)
+    _engine = std::move(unbounded);
 
-  return model;
+  if (shortest) {
+    _result = Result::SATISFIABLE;
+    if (proven)
+      _state = State::DONE;
+    minimize(*shortest);
+  }
+
+  return shortest;
 }
 
 FormulaPtr inline Solver::Formula() const
@@ -771,70 +906,18 @@ void Solver::_print_stats() const
 	format::debug("Cross by contradiction: {}",
 				  _stats.cross_by_contradiction);
 	format::debug("Cross by prune: {}", _stats.cross_by_prune);
-}
-
-void Solver::__dump_frame(Frame const*frame) const
-{
-  format::verbose("Frame n. {}", (size_t)frame->id);
-  format::verbose("Prev frame n. {}", (size_t)frame->prev->id);
-  format::verbose("First frame n. {}", (size_t)frame->first->id);
-  __dump_frame_formulas(frame);
-
-  format::verbose("- Eventualities:");
-  __dump_requested_eventualities(frame);
-  __dump_satisfied_eventualities(frame);
-
-  format::verbose("");
-}
-
-void Solver::__dump_frame_formulas(Frame const*frame) const
-{
-  PrettyPrinter p;
-  format::verbose("- Formulas:");
-  for (uint64_t i = 0; i < _subformulas.size(); ++i)
-    if (frame->formulas[i])
-      format::verbose("  - {}", p.to_string(_subformulas[i]));
-}
-
-void Solver::__dump_satisfied_eventualities(Frame const*frame) const
-{
-  PrettyPrinter p;
-  size_t i = 0;
-
-  format::verbose("  - Satisfied: ");
-  for(Eventuality ev : frame->eventualities) {
-    if(ev.is_satisfied() && ev.id() >= frame->first->id)
-      format::verbose("    - {} at {}",
-        p.to_string(_subformulas[_bw_eventualities_lut[i]]), (size_t)ev.id());
-    ++i;
-  }
-}
-
-void Solver::__dump_requested_eventualities(Frame const*frame) const
-{
-  PrettyPrinter p;
-
-  format::verbose("  - Requested:");
-  for(size_t i = 0; i < _number_of_formulas; ++i) {
-    if(frame->requests[i])
-      format::verbose("    - {}", p.to_string(_subformulas[i]));
-  }
-}
-
-void Solver::__dump_current_branch() const
-{
-  PrettyPrinter p;
-  std::deque<Frame const*> frames;
-  Frame const*current_frame = &_stack.top();
-
-  while(current_frame) {
-    frames.push_front(current_frame);
-    current_frame = current_frame->chain;
-  }
-
-  for(Frame const*frame : frames) {
-    __dump_frame(frame);
-  }
+	format::debug("Cross by depth: {}", _stats.cross_by_depth);
+	format::debug("Propagations: {}", _stats.propagations);
+	format::debug("Backjumps: {}", _stats.backjumps);
+	format::debug("Lookaheads: {}", _stats.lookaheads);
+	format::debug("Lookahead failures: {}", _stats.lookahead_failures);
+	format::debug("Restarts: {}", _stats.restarts);
+	format::debug("Cache hits: {}", _stats.cache_hits);
+	format::debug("Cache misses: {}", _stats.cache_misses);
+	format::debug("Cache evictions: {}", _stats.cache_evictions);
+	format::debug("Learned clauses: {}", _stats.clauses_learned);
+	format::debug("Learned clause hits: {}", _stats.clause_hits);
+	format::debug("Learned clause deletions: {}", _stats.clause_deletions);
 }
 
 static bool formula_ordering_func(const FormulaPtr& a, const FormulaPtr& b)
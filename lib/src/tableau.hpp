@@ -0,0 +1,2203 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include "engine.hpp"
+#include "format.hpp"
+#include "frame.hpp"
+#include "frame_index.hpp"
+#include "learned_clauses.hpp"
+#include "nogood_cache.hpp"
+#include "pretty_printer.hpp"
+#include "sat_solver.hpp"
+#include "stack.hpp"
+#include "work_queue.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#ifdef _MSC_VER
+#define __builtin_expect(cond, value) (cond)
+#endif
+
+namespace LTL {
+namespace detail {
+
+// The term of the Luby sequence at the given index, from zero: every
+// subsequence 1 1 2 ... 2^k is followed by itself and then by 2^(k+1)
+inline uint64_t luby(uint64_t index)
+{
+  uint64_t size = 1;
+  uint64_t power = 0;
+  while (size < index + 1) {
+    ++power;
+    size = 2 * size + 1;
+  }
+
+  while (size - 1 != index) {
+    size = (size - 1) / 2;
+    --power;
+    index = index % size;
+  }
+
+  return uint64_t(1) << power;
+}
+
+/*
+ * The tableau search itself. It is instantiated on the bitset type used for
+ * the frames, so that small closures (the vast majority) get fixed-width
+ * inline bitsets with fully unrolled operations, and only huge ones fall back
+ * to DynamicBitset.
+ */
+template <typename Bitset>
+class Tableau : public Engine {
+  using Frame = detail::Frame<Bitset>;
+  using Stack = detail::stack<Frame>;
+
+public:
+  explicit Tableau(Solver &solver);
+  Tableau(Solver &solver, Solver::Stats &stats, WorkQueue *queue,
+          uint32_t shares);
+  virtual ~Tableau() override {}
+
+  virtual Outcome solution() override;
+  virtual ModelPtr model() const override;
+  virtual void reset(const DynamicBitset &initial) override;
+
+  // Runs the search from where it stopped, or from the next alternative if
+  // it stopped on a model
+  Outcome search();
+
+  // Starts over from the initial state, taking the given alternatives at the
+  // first choices and searching only the subtree they lead to
+  Outcome start(const WorkQueue::Path &path);
+
+  // Runs the search from where it stopped, down to the given number of
+  // choices only, giving every branch still open there to the cubes
+  Outcome split(size_t depth, std::deque<WorkQueue::Path> &cubes);
+
+private:
+  Solver &_solver;
+  Solver::Stats &_stats;
+  const Solver::Strategy &_strategy; // Rule order and branching
+
+  // Only set in the parallel mode, where idle workers get the oldest open
+  // choice of another one as the path of alternatives leading to it
+  WorkQueue *_queue;
+
+  /* Parts of the memory and frames budgets given to this worker */
+  const uint32_t _shares;
+
+  // States between two checks of the clock and the memory
+  static constexpr uint32_t BUDGET_CHECK_INTERVAL = 256;
+  uint32_t _budget_countdown;
+  uint64_t _frames_limit;
+
+  /*
+   * Restarts of the current search, and the total frames of the next one.
+   * What has been learned is kept across them.
+   */
+  uint64_t _restarts;
+  uint64_t _next_restart;
+  uint64_t _seed; // Of the random branching
+
+  bool _found_model; // The search stopped on a model
+
+  Outcome (Tableau::*_search_loop)(); // Specialized on the closure
+
+  /* Read-only views of the closure built by the Solver */
+  const std::vector<FormulaID> &_lhs;
+  const std::vector<FormulaID> &_rhs;
+  const std::vector<FormulaID> &_fw_eventualities_lut;
+  const std::vector<FormulaID> &_bw_eventualities_lut;
+  const size_t _number_of_formulas;
+
+  /* Copy of Solver::_alpha_closure, in the bitset type of the frames */
+  std::vector<Bitset> _alpha_closure;
+
+  /* Random key of every formula, for the fingerprints */
+  std::vector<uint64_t> _zobrist;
+
+  /*
+   * Formulas added by each alternative of a choice formula, or max(), so that
+   * a choice with an alternative adding nothing new is taken without pushing
+   */
+  struct Watch
+  {
+    FormulaID alternative[2][2];
+  };
+  std::vector<Watch> _watches; // Indexed by formula, set only on choices
+
+  /*
+   * Scores of the choice formulas for the branching strategies: the number
+   * of alternatives, with nested disjunctions flattened, and the number of
+   * formulas of the closure having as subformula what the alternatives add.
+   */
+  std::vector<uint32_t> _options;
+  std::vector<uint32_t> _sharing;
+
+  /* Alternatives of the choices adding each eventuality, by eventuality */
+  struct Fulfilment
+  {
+    FormulaID formula;
+    bool second;
+  };
+  std::vector<std::vector<Fulfilment>> _fulfilments;
+
+  /* Eventualities requested by the state, by the last frame fulfilling them */
+  std::vector<std::pair<int64_t, size_t>> _waiting;
+
+  /* Negation of every atom and atom of every negation, or max() */
+  std::vector<FormulaID> _complement;
+
+  struct
+  {
+    Bitset negation;
+    Bitset tomorrow;
+    Bitset always;
+    Bitset eventually;
+    Bitset conjunction;
+    Bitset disjunction;
+    Bitset until;
+    Bitset release;
+    Bitset eventualities;
+
+    /* Eventually and until formulas, which request an eventuality */
+    Bitset requesting;
+
+    /* Conjunctions and always formulas, whose expansion is deterministic */
+    Bitset alpha;
+
+    /* Formulas expanded by a choice between two alternatives */
+    Bitset choice;
+
+    /* These are used to do computations avoiding allocations */
+    Bitset temporary;
+    Bitset expansion;
+    Bitset pending;
+
+    /* What an alternative adds, for the lookahead */
+    Bitset lookahead;
+
+    /* Formulas met by _lift(), and the explanation of the state itself */
+    Bitset lifted;
+    Bitset explanation;
+  } _bitset;
+
+  /* The state currently being expanded */
+  struct
+  {
+    FrameID id;
+    Bitset formulas;
+    uint64_t fingerprint;
+    Bitset processed;
+    DynamicBitset requests; // Indexed by eventuality, as in the frames
+  } _current;
+
+  /*
+   * States with fewer choices left than this are not worth a SAT check of
+   * their propositional expansion, see _check_propositional_rule(). Any
+   * value from two to eight takes the same time on the test suite, while
+   * from sixteen up the branching on guards of random clauses over 40 to 60
+   * atoms no longer ends within half a minute. The largest one saves the
+   * most calls on the states with few choices.
+   */
+  static constexpr size_t SAT_CHECK_CHOICES = 8;
+
+  CdclSolver _sat;
+  std::vector<SatSolver::Literal> _sat_assumptions;
+
+  /* Bitsets of eventualities used by the loop and prune rules */
+  std::vector<uint64_t> _ev_blocks;
+  BitsetRef _since_prev; // Fulfilled by the top frame after its prev frame
+  BitsetRef _ev_temporary;
+
+  /*
+   * Backtracking is done SAT-solver style: a choice only records the length
+   * of the trail, and going back to it undoes the log down to there.
+   *
+   * Every entry of the trail is the index of a bit that has been set in one
+   * of the bitsets of _current, tagged with the bitset it belongs to, or a
+   * STEP marker, undone by restoring the saved frame. Requests are indexed by eventuality, the rest by formula.
+   * The entries of formulas also keep the level they have overwritten in
+   * their upper half.
+   */
+  enum Change : uint32_t { FORMULA = 0, PROCESSED = 1, REQUEST = 2, STEP = 3 };
+  static constexpr uint32_t CHANGE_BITS = 2;
+
+  struct Choice
+  {
+    size_t trail_size; // Length of the trail when the choice was made
+    size_t frames;     // Size of the stack when the choice was made
+    FormulaID formula; // The formula we are branching on
+    bool second;       // Whether we are exploring the second alternative
+    bool open;         // Whether the other alternative is still to explore
+    bool explained;    // Whether every branch under it has been explained
+  };
+
+  std::vector<uint64_t> _trail;
+  std::vector<Choice> _choices;
+  size_t _open_from; // Every choice before this one is closed
+
+  /*
+   * Choices each formula of _current depends on, valid while it is set, so
+   * that a cross jumps back over the choices unrelated to it. The
+   * levels overwritten by the successors of the stepped frames are saved
+   * here as pairs of formula and level, followed by their number.
+   */
+  std::vector<uint32_t> _levels;
+  std::vector<uint32_t> _saved_levels;
+
+  /*
+   * What added each formula of _current to the state: the formula whose rule
+   * did it, and the one clashing with the other alternative when it has been
+   * forced by the propagation rule, with where it has been logged on the
+   * trail. The formulas the state started from have neither.
+   */
+  struct Reason
+  {
+    FormulaID formula;
+    FormulaID clash = FormulaID::max();
+    size_t position = 0;
+  };
+  std::vector<Reason> _reasons;
+  std::vector<FormulaID> _lifting;
+
+  /* Formulas explaining the crosses met under each choice, by index */
+  std::vector<Bitset> _explanations;
+
+  /* Whether every branch of the state has been explained so far */
+  bool _learning;
+
+  /* Alternatives to take at the first choices, when working on a stolen task */
+  WorkQueue::Path _replay;
+  size_t _replay_pos;
+
+  /* Where the branches go past the depth of a split, only set meanwhile */
+  std::deque<WorkQueue::Path> *_cubes;
+  size_t _split_depth;
+  Stack _stack;
+  FrameIndex<Frame> _branch; // By fingerprint, for the loop and prune rules
+
+  /* Formulas of the frames whose subtree has been closed on its own */
+  NogoodCache<Bitset> _nogoods;
+
+  /* Formulas found unable to be together by lifting the explanations */
+  LearnedClauses<Bitset> _learned;
+
+  FrameID _loop_state;
+  size_t _model_size;
+
+  inline void _set(Change which, size_t pos);
+  inline void _add(size_t formula, uint32_t level, Reason reason);
+  inline FormulaID _source(size_t formula) const;
+  inline void _compute_pending();
+  inline uint32_t _contradiction_level();
+  inline FormulaID _clash_source(size_t formula, bool second) const;
+  inline bool _look_ahead(FormulaID formula, bool second, FormulaID &clash,
+                          size_t &added);
+  inline uint32_t _formulas_level() const;
+  inline Bitset *_explanation();
+  inline void _lift(Bitset &explanation, size_t trail_size);
+  inline void _learn(const Bitset &clause);
+  inline void _unexplain_branch();
+  inline void _undo(size_t trail_size);
+  inline void _pop_frame();
+  void _set_initial_state(const DynamicBitset &initial);
+
+  inline void _push_choice(FormulaID formula, bool second);
+  inline void _pop_choice();
+  inline void _share_work();
+  inline void _cut();
+  inline void _apply_alternative(FormulaID formula, bool second,
+                                 uint32_t level,
+                                 FormulaID clash = FormulaID::max());
+
+  /* Choice operators found in the closure, to specialize the loop on */
+  enum Operators : uint8_t { EVENTUALLY = 1, UNTIL = 2, RELEASE = 4 };
+  static constexpr uint8_t EVENTUALITIES = EVENTUALLY | UNTIL;
+
+  template <uint8_t Ops>
+  Outcome _search();
+  void _select_search_loop();
+  static size_t _nogoods_budget(const Solver &solver, uint32_t shares);
+
+  template <uint8_t Ops>
+  inline void _request_eventuality(FormulaID formula);
+
+  void _make_watches();
+  void _make_scores();
+  uint32_t _count_options(FormulaID formula);
+
+  inline bool _check_contradiction_rule();
+  inline bool _check_propositional_rule();
+  inline bool _check_learned_rule(uint32_t &level);
+  enum class Propagation { NONE, APPLIED, CONFLICT };
+
+  template <uint8_t Ops>
+  inline Propagation _apply_propagation_rule(FormulaID one, uint32_t &level,
+                                             bool &second);
+  inline bool _apply_conjunction_rule();
+  inline bool _apply_always_rule();
+  template <uint8_t Ops>
+  inline FormulaID _apply_expansion_rules(bool &applied, bool &second);
+  template <uint8_t Ops>
+  inline FormulaID _pending_choice(Solver::Strategy::Rule rule, bool &second);
+  inline FormulaID _requested_choice(bool &second);
+  inline void _apply_step_rule();
+  inline uint64_t _successor_formulas(const Frame &frame, Bitset &formulas);
+
+  inline bool _rollback_to_latest_choice();
+  inline bool _rollback_to_latest_choice(uint32_t level);
+  inline bool _out_of_budget();
+  inline void _schedule_restart();
+  inline void _restart();
+  size_t _memory_usage() const;
+  inline void _update_eventualities();
+  inline void _update_history();
+
+  inline std::pair<bool, FrameID> _check_loop_rule() const;
+  inline bool _check_prune0_rule() const;
+  inline bool _check_prune_rule();
+
+  void __dump_frame(Frame const *frame) const;
+  void __dump_frame_formulas(Frame const *frame) const;
+  void __dump_requested_eventualities(Frame const *frame) const;
+  void __dump_satisfied_eventualities(Frame const *frame) const;
+  void __dump_current_branch() const;
+};
+
+template <typename Bitset>
+Tableau<Bitset>::Tableau(Solver &solver)
+  : Tableau(solver, solver._stats, nullptr, 1)
+{
+}
+
+template <typename Bitset>
+Tableau<Bitset>::Tableau(Solver &solver, Solver::Stats &stats,
+                         WorkQueue *queue, uint32_t shares)
+  : _solver(solver),
+    _stats(stats),
+    _strategy(solver._strategy),
+    _queue(queue),
+    _shares(shares),
+    _budget_countdown(BUDGET_CHECK_INTERVAL),
+    _frames_limit(0),
+    _restarts(0),
+    _next_restart(0),
+    _seed(0),
+    _found_model(false),
+    _search_loop(nullptr),
+    _lhs(solver._lhs),
+    _rhs(solver._rhs),
+    _fw_eventualities_lut(solver._fw_eventualities_lut),
+    _bw_eventualities_lut(solver._bw_eventualities_lut),
+    _number_of_formulas(solver._number_of_formulas),
+    _alpha_closure(),
+    _zobrist(),
+    _watches(),
+    _options(),
+    _sharing(),
+    _fulfilments(),
+    _waiting(),
+    _complement(),
+    _bitset(),
+    _current(),
+    _sat(),
+    _sat_assumptions(),
+    _ev_blocks(2 * blocks_for(_bw_eventualities_lut.size())),
+    _since_prev(_ev_blocks.data(), blocks_for(_bw_eventualities_lut.size())),
+    _ev_temporary(_ev_blocks.data() + blocks_for(_bw_eventualities_lut.size()),
+                  blocks_for(_bw_eventualities_lut.size())),
+    _trail(),
+    _choices(),
+    _open_from(0),
+    _levels(),
+    _saved_levels(),
+    _reasons(),
+    _lifting(),
+    _explanations(),
+    _learning(false),
+    _replay(),
+    _replay_pos(0),
+    _cubes(nullptr),
+    _split_depth(0),
+    _stack(Frame::size_for(_bw_eventualities_lut.size())),
+    _branch(),
+    _nogoods(_number_of_formulas, _nogoods_budget(solver, shares)),
+    _learned(_number_of_formulas),
+    _loop_state(0),
+    _model_size(0)
+{
+  _bitset.negation = Bitset(_number_of_formulas);
+  _bitset.negation.assign(solver._bitset.negation);
+  _bitset.tomorrow = Bitset(_number_of_formulas);
+  _bitset.tomorrow.assign(solver._bitset.tomorrow);
+  _bitset.always = Bitset(_number_of_formulas);
+  _bitset.always.assign(solver._bitset.always);
+  _bitset.eventually = Bitset(_number_of_formulas);
+  _bitset.eventually.assign(solver._bitset.eventually);
+  _bitset.conjunction = Bitset(_number_of_formulas);
+  _bitset.conjunction.assign(solver._bitset.conjunction);
+  _bitset.disjunction = Bitset(_number_of_formulas);
+  _bitset.disjunction.assign(solver._bitset.disjunction);
+  _bitset.until = Bitset(_number_of_formulas);
+  _bitset.until.assign(solver._bitset.until);
+  _bitset.release = Bitset(_number_of_formulas);
+  _bitset.release.assign(solver._bitset.release);
+  _bitset.eventualities = Bitset(_number_of_formulas);
+  _bitset.eventualities.assign(solver._bitset.eventualities);
+  _bitset.alpha = _bitset.conjunction;
+  _bitset.alpha |= _bitset.always;
+  _bitset.choice = _bitset.disjunction;
+  _bitset.choice |= _bitset.eventually;
+  _bitset.choice |= _bitset.until;
+  _bitset.choice |= _bitset.release;
+  _bitset.requesting = _bitset.eventually;
+  _bitset.requesting |= _bitset.until;
+  _bitset.temporary = Bitset(_number_of_formulas);
+  _bitset.expansion = Bitset(_number_of_formulas);
+  _bitset.pending = Bitset(_number_of_formulas);
+  _bitset.lookahead = Bitset(_number_of_formulas);
+  _bitset.lifted = Bitset(_number_of_formulas);
+  _bitset.explanation = Bitset(_number_of_formulas);
+
+  _alpha_closure.reserve(_number_of_formulas);
+  for (const DynamicBitset &closure : solver._alpha_closure) {
+    _alpha_closure.emplace_back(_number_of_formulas);
+    _alpha_closure.back().assign(closure);
+  }
+
+  _zobrist.reserve(_number_of_formulas);
+  for (uint64_t i = 0; i < _number_of_formulas; ++i)
+    _zobrist.push_back(mix64(i + 1));
+
+  _make_watches();
+  _make_scores();
+  _select_search_loop();
+
+  solver._encode_closure(_sat);
+
+  _current.id = FrameID(0);
+  _current.formulas = Bitset(_number_of_formulas);
+  _current.processed = Bitset(_number_of_formulas);
+  _current.requests = DynamicBitset(_bw_eventualities_lut.size());
+  _levels.resize(_number_of_formulas);
+  _reasons.resize(_number_of_formulas);
+  _set_initial_state(solver._initial);
+}
+
+template <typename Bitset>
+void Tableau<Bitset>::_set_initial_state(const DynamicBitset &initial)
+{
+  _current.id = FrameID(0);
+  _current.formulas.assign(initial);
+  _current.processed.reset();
+  _current.requests.reset();
+
+  _current.fingerprint = 0;
+  for (size_t pos = initial.find_first(); pos != Bitset::npos;
+       pos = initial.find_next(pos)) {
+    _current.fingerprint ^= _zobrist[pos];
+    _levels[pos] = 0;
+    _reasons[pos] = {FormulaID::max()};
+  }
+
+  _bitset.explanation.reset();
+  _learning = true;
+}
+
+template <typename Bitset>
+void Tableau<Bitset>::_set(Change which, size_t pos)
+{
+  if (which == REQUEST) {
+    if (_current.requests.test(pos))
+      return;
+
+    _current.requests.set(pos);
+    _trail.push_back((pos << CHANGE_BITS) | which);
+    return;
+  }
+
+  assert(which == PROCESSED);
+  if (_current.processed.test(pos))
+    return;
+
+  _current.processed.set(pos);
+  _trail.push_back((pos << CHANGE_BITS) | which);
+}
+
+// Adds a formula depending on the first level choices
+template <typename Bitset>
+void Tableau<Bitset>::_add(size_t formula, uint32_t level, Reason reason)
+{
+  if (_current.formulas.test(formula))
+    return;
+
+  _current.formulas.set(formula);
+  _current.fingerprint ^= _zobrist[formula];
+  _trail.push_back(uint64_t(_levels[formula]) << 32 |
+                   (formula << CHANGE_BITS) | FORMULA);
+  _levels[formula] = level;
+  _reasons[formula] = reason;
+  _reasons[formula].position = _trail.size() - 1;
+}
+
+// The formula of the state another one comes from: itself, or the one of the
+// lowest level among the pending conjunctions and always formulas expanding
+// to it. These must have been computed in _bitset.pending.
+template <typename Bitset>
+FormulaID Tableau<Bitset>::_source(size_t formula) const
+{
+  if (_current.formulas[formula])
+    return FormulaID(formula);
+
+  FormulaID source = FormulaID::max();
+  size_t one = _bitset.pending.find_first();
+  while (one != Bitset::npos) {
+    if ((source == FormulaID::max() || _levels[one] < _levels[source]) &&
+        _alpha_closure[one][formula])
+      source = FormulaID(one);
+    one = _bitset.pending.find_next(one);
+  }
+
+  assert(source != FormulaID::max());
+  return source;
+}
+
+template <typename Bitset>
+void Tableau<Bitset>::_compute_pending()
+{
+  _bitset.pending = _current.formulas;
+  _bitset.pending &= _bitset.alpha;
+  _bitset.pending -= _current.processed;
+}
+
+// The lowest level among the clashes found by the contradiction rule, which
+// leaves them in _bitset.temporary. Most of them depend on the latest choice,
+// which is checked first on the expansion of the formulas coming before it.
+// The clash giving the level is the one explaining the cross.
+template <typename Bitset>
+uint32_t Tableau<Bitset>::_contradiction_level()
+{
+  const uint32_t latest = uint32_t(_choices.size());
+  _compute_pending();
+
+  _bitset.expansion.reset();
+  _current.formulas.for_each([&](size_t f) {
+    if (_levels[f] < latest) {
+      _bitset.expansion.set(f);
+      if (_bitset.pending[f])
+        _bitset.expansion |= _alpha_closure[f];
+    }
+  });
+
+  bool earlier = false;
+  _bitset.temporary.for_each([&](size_t one) {
+    earlier = earlier || (_bitset.expansion[one] && _bitset.expansion[one + 1]);
+  });
+
+  uint32_t level = latest;
+  size_t clash = _bitset.temporary.find_first();
+
+  if (earlier) {
+    level = UINT32_MAX;
+
+    size_t one = _bitset.temporary.find_first();
+    while (one != Bitset::npos) {
+      uint32_t clash_level =
+        std::max(_levels[_source(one)], _levels[_source(one + 1)]);
+      if (clash_level < level) {
+        level = clash_level;
+        clash = one;
+      }
+      one = _bitset.temporary.find_next(one);
+    }
+  }
+
+  if (Bitset *explanation = _explanation()) {
+    explanation->set(_source(clash));
+    explanation->set(_source(clash + 1));
+  }
+
+  return level;
+}
+
+// The source of the lowest level among the clashes of an alternative with the
+// state
+template <typename Bitset>
+FormulaID Tableau<Bitset>::_clash_source(size_t formula, bool second) const
+{
+  FormulaID source = FormulaID::max();
+
+  for (FormulaID added : _watches[formula].alternative[second]) {
+    if (added == FormulaID::max() || _complement[added] == FormulaID::max() ||
+        !_bitset.expansion[_complement[added]])
+      continue;
+
+    FormulaID one = _source(_complement[added]);
+    if (source == FormulaID::max() || _levels[one] < _levels[source])
+      source = one;
+  }
+
+  assert(source != FormulaID::max());
+  return source;
+}
+
+// Checks an alternative of a choice on the state as expanded by the
+// contradiction rule, together with the closure of what it adds, and counts
+// the formulas it would add. When they contradict each other, the formula
+// of the state with the lowest level among the clashing ones is left in
+// clash, or max() when the alternative contradicts itself.
+template <typename Bitset>
+bool Tableau<Bitset>::_look_ahead(FormulaID formula, bool second,
+                                  FormulaID &clash, size_t &added)
+{
+  _bitset.lookahead.reset();
+  for (FormulaID one : _watches[formula].alternative[second])
+    if (one != FormulaID::max())
+      _bitset.lookahead |= _alpha_closure[one];
+
+  _bitset.temporary = _bitset.lookahead;
+  _bitset.temporary -= _bitset.expansion;
+  added = _bitset.temporary.count();
+
+  _bitset.temporary |= _bitset.expansion;
+  _bitset.lookahead = _bitset.temporary;
+  _bitset.lookahead &= _bitset.negation;
+  _bitset.lookahead >>= 1;
+  _bitset.lookahead &= _bitset.temporary;
+
+  clash = FormulaID::max();
+  bool found = false;
+  size_t one = _bitset.lookahead.find_first();
+  while (one != Bitset::npos) {
+    if (!_bitset.expansion[one] && !_bitset.expansion[one + 1]) {
+      clash = FormulaID::max();
+      return true;
+    }
+
+    FormulaID source = _source(_bitset.expansion[one] ? one : one + 1);
+    if (!found || _levels[source] < _levels[clash])
+      clash = source;
+    found = true;
+    one = _bitset.lookahead.find_next(one);
+  }
+
+  return found;
+}
+
+template <typename Bitset>
+uint32_t Tableau<Bitset>::_formulas_level() const
+{
+  uint32_t level = 0;
+
+  size_t one = _current.formulas.find_first();
+  while (one != Bitset::npos) {
+    level = std::max(level, _levels[one]);
+    one = _current.formulas.find_next(one);
+  }
+
+  return level;
+}
+
+// Where the formulas explaining a cross go: the explanation of the latest
+// choice made on the state, or of the state itself. There is none when some
+// branch of them has not been crossed by a contradiction.
+template <typename Bitset>
+Bitset *Tableau<Bitset>::_explanation()
+{
+  if (!_choices.empty() && _choices.back().frames == _stack.size())
+    return _choices.back().explained ? &_explanations[_choices.size() - 1]
+                                     : nullptr;
+
+  return _learning ? &_bitset.explanation : nullptr;
+}
+
+// Replaces the formulas of an explanation logged after the given length of
+// the trail with the ones they come from, until it is left with formulas from
+// before. A formula whose reason has been overwritten by a later state, which
+// is no longer the one logged, is kept as it is: it still explains the cross.
+template <typename Bitset>
+void Tableau<Bitset>::_lift(Bitset &explanation, size_t trail_size)
+{
+  auto added_after = [&](size_t one) {
+    const Reason &reason = _reasons[one];
+    return reason.formula != FormulaID::max() &&
+           reason.position >= trail_size && reason.position < _trail.size() &&
+           uint32_t(_trail[reason.position]) ==
+             ((one << CHANGE_BITS) | FORMULA);
+  };
+
+  _bitset.lifted.reset();
+  explanation.for_each([&](size_t one) {
+    if (added_after(one))
+      _lifting.push_back(FormulaID(one));
+  });
+
+  while (!_lifting.empty()) {
+    FormulaID one = _lifting.back();
+    _lifting.pop_back();
+
+    if (_bitset.lifted[one])
+      continue;
+    _bitset.lifted.set(one);
+
+    if (!added_after(one)) {
+      explanation.set(one);
+      continue;
+    }
+
+    const Reason &reason = _reasons[one];
+    explanation.reset(one);
+    _lifting.push_back(reason.formula);
+    if (reason.clash != FormulaID::max())
+      _lifting.push_back(reason.clash);
+  }
+}
+
+// Clauses already implied by a learned one are not learned again
+template <typename Bitset>
+void Tableau<Bitset>::_learn(const Bitset &clause)
+{
+  if (clause.none() || _learned.find(clause) != LearnedClauses<Bitset>::npos)
+    return;
+
+  _learned.add(clause);
+  ++_stats.clauses_learned;
+  _stats.clause_deletions = _learned.deletions();
+}
+
+// Some branch under the latest choice has not been crossed by a contradiction,
+// and so neither has one under the choices before it, nor under the state. The
+// choices still explained always come after all the others.
+template <typename Bitset>
+void Tableau<Bitset>::_unexplain_branch()
+{
+  for (size_t i = _choices.size(); i-- > 0 && _choices[i].explained;)
+    _choices[i].explained = false;
+  _learning = false;
+}
+
+template <typename Bitset>
+void Tableau<Bitset>::_undo(size_t trail_size)
+{
+  while (_trail.size() > trail_size) {
+    uint64_t change = _trail.back();
+    size_t pos = uint32_t(change) >> CHANGE_BITS;
+    _trail.pop_back();
+
+    switch (static_cast<Change>(change & ((1 << CHANGE_BITS) - 1))) {
+      case FORMULA:
+        _current.formulas.reset(pos);
+        _current.fingerprint ^= _zobrist[pos];
+        _levels[pos] = uint32_t(change >> 32);
+        break;
+      case PROCESSED:
+        _current.processed.reset(pos);
+        break;
+      case REQUEST:
+        _current.requests.reset(pos);
+        break;
+      case STEP:
+        _pop_frame();
+        break;
+    }
+  }
+}
+
+// Restores the working set from the frame on top of the stack, recording the
+// formulas which followed it as unsatisfiable if the subtree they started has
+// been closed by reasons found entirely inside of it
+template <typename Bitset>
+void Tableau<Bitset>::_pop_frame()
+{
+  Frame &frame = _stack.top();
+
+  if (frame.stepped && frame.horizon > frame.id) {
+    _successor_formulas(frame, _bitset.expansion);
+    _nogoods.insert(_bitset.expansion);
+    _stats.cache_evictions = _nogoods.evictions();
+  }
+
+  FrameID horizon = frame.horizon;
+  if (frame.first != &frame)
+    horizon = std::min(horizon, frame.first->id);
+
+  if (frame.stepped) {
+    size_t saved = _saved_levels.size() - 1 - 2 * _saved_levels.back();
+    for (size_t i = saved; i + 1 < _saved_levels.size(); i += 2)
+      _levels[_saved_levels[i]] = _saved_levels[i + 1];
+    _saved_levels.resize(saved);
+  }
+
+  // The state has a successor, so its branches are not all explained
+  _learning = false;
+
+  _current.id = frame.id;
+  _current.formulas = frame.formulas;
+  _current.fingerprint = frame.fingerprint;
+  _current.processed = frame.processed;
+  _current.requests.assign(frame.requests());
+  _branch.pop(frame);
+  _stack.pop();
+
+  if (!_stack.empty())
+    _stack.top().horizon = std::min(_stack.top().horizon, horizon);
+}
+
+// While replaying the path of a stolen task the alternative is forced, and
+// the choice is closed right away as its other alternative is someone else's
+template <typename Bitset>
+void Tableau<Bitset>::_push_choice(FormulaID formula, bool second)
+{
+  if (__builtin_expect(_replay_pos < _replay.size(), 0)) {
+    second = _replay[_replay_pos++];
+    _choices.push_back(
+      {_trail.size(), _stack.size(), formula, second, false, false});
+    _unexplain_branch();
+    _apply_alternative(formula, second, uint32_t(_choices.size()));
+  }
+  else {
+    if (_explanations.size() <= _choices.size())
+      _explanations.resize(_choices.size() + 1, Bitset(_number_of_formulas));
+    _explanations[_choices.size()].reset();
+
+    _choices.push_back(
+      {_trail.size(), _stack.size(), formula, second, true, true});
+    _apply_alternative(formula, second, uint32_t(_choices.size()));
+
+    if (_queue && _queue->wants_work())
+      _share_work();
+  }
+
+  ++_stats.total_frames;
+  _stats.maximum_frames =
+    std::max(_stats.maximum_frames,
+             static_cast<uint64_t>(_stack.size() + _choices.size() + 1));
+}
+
+// Drops the latest choice. When every branch explored under it has been
+// explained, so is the choice itself: its explanation is learned, and handed
+// over to the choice or the state it has been made on.
+template <typename Bitset>
+void Tableau<Bitset>::_pop_choice()
+{
+  const size_t index = _choices.size() - 1;
+  const Choice &choice = _choices[index];
+
+  if (choice.explained) {
+    Bitset &explanation = _explanations[index];
+    _lift(explanation, choice.trail_size);
+    _learn(explanation);
+
+    if (index > 0 && _choices[index - 1].frames == choice.frames) {
+      if (_choices[index - 1].explained)
+        _explanations[index - 1] |= explanation;
+    }
+    else if (_learning)
+      _bitset.explanation |= explanation;
+  }
+
+  _choices.pop_back();
+  _open_from = std::min(_open_from, _choices.size());
+}
+
+// Gives the oldest open choice away to the queue. The frame it has been made
+// after has now part of its subtree explored elsewhere, so it must not end up
+// in the cache, and neither must anything before it.
+template <typename Bitset>
+void Tableau<Bitset>::_share_work()
+{
+  while (_open_from < _choices.size() && !_choices[_open_from].open)
+    ++_open_from;
+
+  if (_open_from == _choices.size())
+    return;
+
+  Choice &choice = _choices[_open_from];
+  choice.open = false;
+  if (choice.frames > 0)
+    _stack[choice.frames - 1].horizon = FrameID(0);
+  for (size_t i = _open_from + 1; i-- > 0 && _choices[i].explained;)
+    _choices[i].explained = false;
+  if (choice.frames == _stack.size())
+    _learning = false;
+
+  WorkQueue::Path path;
+  path.reserve(_open_from + 1);
+  for (size_t i = 0; i < _open_from; ++i)
+    path.push_back(_choices[i].second);
+  path.push_back(!choice.second);
+
+  _queue->give(std::move(path));
+}
+
+// Gives the branch away to a cube, made of the alternatives taken so far.
+// As with _share_work(), its subtree is explored elsewhere, so neither the
+// frame it has reached nor anything before it can end up in the cache, and
+// nothing is learned from it.
+template <typename Bitset>
+void Tableau<Bitset>::_cut()
+{
+  if (!_stack.empty())
+    _stack.top().horizon = FrameID(0);
+  _unexplain_branch();
+
+  WorkQueue::Path path;
+  path.reserve(_choices.size());
+  for (const Choice &choice : _choices)
+    path.push_back(choice.second);
+
+  _cubes->push_back(std::move(path));
+}
+
+// The second alternative of until and release formulas adds their tomorrow
+// formula, which comes right after them, or after their negation
+template <typename Bitset>
+void Tableau<Bitset>::_make_watches()
+{
+  const FormulaID none = FormulaID::max();
+  _watches.assign(_number_of_formulas, Watch{{{none, none}, {none, none}}});
+  _complement.assign(_number_of_formulas, none);
+
+  for (size_t f = 0; f < _number_of_formulas; ++f) {
+    FormulaID(&alternative)[2][2] = _watches[f].alternative;
+    FormulaID next = none;
+    if (_bitset.until[f] || _bitset.release[f]) {
+      next = FormulaID(_bitset.tomorrow[f + 1] && _lhs[f + 1] == FormulaID(f)
+                         ? f + 1
+                         : f + 2);
+      assert(_bitset.tomorrow[next] && _lhs[next] == FormulaID(f));
+    }
+
+    if (_bitset.disjunction[f]) {
+      alternative[0][0] = _lhs[f];
+      alternative[1][0] = _rhs[f];
+    }
+    else if (_bitset.eventually[f]) {
+      assert(_bitset.tomorrow[f + 1] && _lhs[f + 1] == FormulaID(f));
+      alternative[0][0] = _lhs[f];
+      alternative[1][0] = FormulaID(f + 1);
+    }
+    else if (_bitset.until[f]) {
+      alternative[0][0] = _rhs[f];
+      alternative[1][0] = _lhs[f];
+      alternative[1][1] = next;
+    }
+    else if (_bitset.release[f]) {
+      alternative[0][0] = _lhs[f];
+      alternative[0][1] = _rhs[f];
+      alternative[1][0] = _rhs[f];
+      alternative[1][1] = next;
+    }
+    else if (_bitset.negation[f] && _solver._atom_set.count(_lhs[f])) {
+      _complement[f] = _lhs[f];
+      _complement[_lhs[f]] = FormulaID(f);
+    }
+  }
+}
+
+template <typename Bitset>
+void Tableau<Bitset>::_make_scores()
+{
+  _options.assign(_number_of_formulas, 0);
+  _sharing.assign(_number_of_formulas, 0);
+
+  std::vector<uint32_t> occurrences(_number_of_formulas, 0);
+  for (size_t f = 0; f < _number_of_formulas; ++f) {
+    if (_lhs[f] != FormulaID::max())
+      ++occurrences[_lhs[f]];
+    if (_rhs[f] != FormulaID::max())
+      ++occurrences[_rhs[f]];
+  }
+
+  for (size_t f = 0; f < _number_of_formulas; ++f) {
+    if (!_bitset.choice[f])
+      continue;
+
+    _count_options(FormulaID(f));
+    for (const auto &alternative : _watches[f].alternative)
+      for (FormulaID added : alternative)
+        if (added != FormulaID::max())
+          _sharing[f] += occurrences[added];
+  }
+
+  // An alternative fulfils the eventualities in the closure of what it adds,
+  // unless the other one does as well
+  _fulfilments.assign(_bw_eventualities_lut.size(), {});
+  Bitset fulfilled[2] = {Bitset(_number_of_formulas),
+                         Bitset(_number_of_formulas)};
+  for (size_t f = 0; f < _number_of_formulas; ++f) {
+    if (!_bitset.choice[f])
+      continue;
+
+    for (int i = 0; i < 2; ++i) {
+      fulfilled[i].reset();
+      for (FormulaID added : _watches[f].alternative[i])
+        if (added != FormulaID::max())
+          fulfilled[i] |= _alpha_closure[added];
+      fulfilled[i] &= _bitset.eventualities;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+      _bitset.temporary = fulfilled[i];
+      _bitset.temporary -= fulfilled[1 - i];
+      size_t one = _bitset.temporary.find_first();
+      while (one != Bitset::npos) {
+        _fulfilments[_fw_eventualities_lut[one]].push_back(
+          {FormulaID(f), i == 1});
+        one = _bitset.temporary.find_next(one);
+      }
+    }
+  }
+}
+
+// Temporal choices have two alternatives, while a disjunction has the ones
+// of its disjuncts, or one for a disjunct which is not a disjunction itself
+template <typename Bitset>
+uint32_t Tableau<Bitset>::_count_options(FormulaID formula)
+{
+  if (_options[formula] == 0) {
+    if (_bitset.disjunction[formula]) {
+      for (FormulaID disjunct : {_lhs[formula], _rhs[formula]})
+        _options[formula] +=
+          _bitset.disjunction[disjunct] ? _count_options(disjunct) : 1;
+    }
+    else
+      _options[formula] = 2;
+  }
+
+  return _options[formula];
+}
+
+template <typename Bitset>
+void Tableau<Bitset>::_apply_alternative(FormulaID formula, bool second,
+                                         uint32_t level, FormulaID clash)
+{
+  assert(_bitset.choice[formula]);
+
+  for (FormulaID added : _watches[formula].alternative[second])
+    if (added != FormulaID::max())
+      _add(added, level, {formula, clash});
+}
+
+// Eventually and until formulas request their eventuality whatever the
+// alternative taken
+template <typename Bitset>
+template <uint8_t Ops>
+void Tableau<Bitset>::_request_eventuality(FormulaID formula)
+{
+  if (!(Ops & EVENTUALITIES))
+    return;
+
+  if ((Ops & EVENTUALLY) && _bitset.eventually[formula]) {
+    assert(_bitset.eventualities[_lhs[formula]]);
+    _set(REQUEST, _fw_eventualities_lut[_lhs[formula]]);
+  }
+  else if ((Ops & UNTIL) && _bitset.until[formula]) {
+    assert(_bitset.eventualities[_rhs[formula]]);
+    _set(REQUEST, _fw_eventualities_lut[_rhs[formula]]);
+  }
+}
+
+// The check is done on the state as it will be once every conjunction and
+// always formula in it has been expanded, nested ones included, which is a
+// single OR of their closures. This crosses the branch before any choice is
+// made on a state which is already bound to contain a contradiction.
+template <typename Bitset>
+bool Tableau<Bitset>::_check_contradiction_rule()
+{
+  _bitset.expansion = _current.formulas;
+
+  _bitset.temporary = _current.formulas;
+  _bitset.temporary &= _bitset.alpha;
+  _bitset.temporary -= _current.processed;
+
+  size_t one = _bitset.temporary.find_first();
+  while (one != Bitset::npos) {
+    _bitset.expansion |= _alpha_closure[one];
+    one = _bitset.temporary.find_next(one);
+  }
+
+  _bitset.temporary = _bitset.expansion;
+  _bitset.temporary &= _bitset.negation;
+  _bitset.temporary >>= 1;
+  _bitset.temporary &= _bitset.expansion;
+  return _bitset.temporary.any();
+}
+
+// Looks at the state as expanded by the contradiction rule. An alternative
+// adding the complement of a formula there is dropped, as it would be crossed
+// right away. One adding only formulas already there is taken, as any model
+// of the state satisfies it, except for the postponing alternative of an
+// eventuality: the prune rules rely on eventualities being fulfilled as soon
+// as possible on some branch.
+//
+// Only the formula the choice rules would branch on next is looked at, so
+// that the order in which the search meets the states is kept. Satisfiable
+// formulas are very sensitive to it, and forcing other choices first can turn
+// a model found in a few frames into millions of them.
+//
+// With the lookahead of the strategy, the alternatives left are looked at
+// again with the closure of what they add. When both survive, the disjunct
+// adding the most formulas is the one to take first. Temporal choices keep
+// their order, as postponing eventualities first, which adds more formulas,
+// leaves the search to the prune rules on deeper and deeper branches.
+template <typename Bitset>
+template <uint8_t Ops>
+typename Tableau<Bitset>::Propagation
+Tableau<Bitset>::_apply_propagation_rule(FormulaID one, uint32_t &level,
+                                         bool &second)
+{
+  bool present[2] = {true, true};
+  bool clashes[2] = {false, false};
+
+  for (int i = 0; i < 2; ++i) {
+    for (FormulaID added : _watches[one].alternative[i]) {
+      if (added == FormulaID::max())
+        continue;
+      present[i] = present[i] && _bitset.expansion[added];
+      clashes[i] = clashes[i] || (_complement[added] != FormulaID::max() &&
+                                  _bitset.expansion[_complement[added]]);
+    }
+  }
+
+  if (_bitset.eventually[one] || _bitset.until[one])
+    present[1] = false;
+
+  // What each alternative clashes with, when found by the lookahead
+  FormulaID sources[2] = {FormulaID::max(), FormulaID::max()};
+  bool probed = false;
+
+  if (!present[0] && !present[1] && !clashes[0] && !clashes[1]) {
+    if (!_strategy.lookahead)
+      return Propagation::NONE;
+
+    _compute_pending();
+    size_t added[2];
+    for (int i = 0; i < 2; ++i)
+      clashes[i] = _look_ahead(one, i == 1, sources[i], added[i]);
+    ++_stats.lookaheads;
+
+    if (!clashes[0] && !clashes[1]) {
+      if (_bitset.disjunction[one] && added[0] != added[1])
+        second = added[1] > added[0];
+      return Propagation::NONE;
+    }
+
+    _stats.lookahead_failures += uint64_t(clashes[0]) + uint64_t(clashes[1]);
+    probed = true;
+  }
+  else
+    _compute_pending();
+
+  auto clash_source = [&](bool i) {
+    return probed ? sources[i] : _clash_source(one, i);
+  };
+  auto clash_level = [&](FormulaID clash) {
+    return clash == FormulaID::max() ? 0 : _levels[clash];
+  };
+
+  if (clashes[0] && clashes[1]) {
+    FormulaID first_clash = clash_source(false);
+    FormulaID second_clash = clash_source(true);
+    level = std::max({_levels[one], clash_level(first_clash),
+                      clash_level(second_clash)});
+
+    if (Bitset *explanation = _explanation()) {
+      explanation->set(one);
+      if (first_clash != FormulaID::max())
+        explanation->set(first_clash);
+      if (second_clash != FormulaID::max())
+        explanation->set(second_clash);
+    }
+    return Propagation::CONFLICT;
+  }
+
+  second = !present[0] && (present[1] || clashes[0]);
+  _set(PROCESSED, one);
+  _request_eventuality<Ops>(FormulaID(one));
+
+  // A present alternative adds formulas only from the pending expansion, and
+  // a forced one depends on the clash of the other
+  if (present[second]) {
+    for (FormulaID added : _watches[one].alternative[second]) {
+      if (added != FormulaID::max()) {
+        FormulaID source = _source(added);
+        _add(added, _levels[source], {source});
+      }
+    }
+  }
+  else {
+    FormulaID clash = clash_source(!second);
+    _apply_alternative(FormulaID(one), second,
+                       std::max(_levels[one], clash_level(clash)), clash);
+  }
+  ++_stats.propagations;
+
+  return Propagation::APPLIED;
+}
+
+// Whether the propositional expansion of a state with many choices left has
+// no model, which branching on them would only find out after trying them all.
+// Only the unsatisfiable answers are used. A model of the expansion leaves
+// the tomorrow formulas free, so it need not lead to a model of the state,
+// and following it would override the branching strategy of the Solver.
+template <typename Bitset>
+bool Tableau<Bitset>::_check_propositional_rule()
+{
+  _bitset.temporary = _current.formulas;
+  _bitset.temporary &= _bitset.choice;
+  _bitset.temporary -= _current.processed;
+
+  if (_bitset.temporary.count() < SAT_CHECK_CHOICES)
+    return false;
+
+  _sat_assumptions.clear();
+  size_t one = _current.formulas.find_first();
+  while (one != Bitset::npos) {
+    _sat_assumptions.push_back(
+      SatSolver::positive(static_cast<SatSolver::Variable>(one)));
+    one = _current.formulas.find_next(one);
+  }
+
+  if (_sat.solve(_sat_assumptions))
+    return false;
+
+  // The formulas the solver has found unsatisfiable together explain it
+  if (Bitset *explanation = _explanation()) {
+    for (SatSolver::Literal literal : _sat.failed_assumptions())
+      explanation->set(SatSolver::variable(literal));
+  }
+
+  return true;
+}
+
+// Only checked when there is a choice to make, which the clause saves
+template <typename Bitset>
+bool Tableau<Bitset>::_check_learned_rule(uint32_t &level)
+{
+  if (_learned.size() == 0)
+    return false;
+
+  _bitset.temporary = _current.formulas;
+  _bitset.temporary &= _bitset.choice;
+  _bitset.temporary -= _current.processed;
+  if (!_bitset.temporary.any())
+    return false;
+
+  size_t clause = _learned.find(_current.formulas);
+  if (clause == LearnedClauses<Bitset>::npos)
+    return false;
+
+  Bitset *explanation = _explanation();
+  level = 0;
+  for (FormulaID formula : _learned[clause]) {
+    level = std::max(level, _levels[formula]);
+    if (explanation)
+      explanation->set(formula);
+  }
+
+  return true;
+}
+
+// Nested conjunctions are added one level per pass on purpose: branches are
+// chosen among the formulas added so far, and adding the whole closure at
+// once makes the search pick deeply nested disjunctions before shallow ones,
+// which takes three times as long on the test suite, with seven more
+// timeouts. The closure is still used in full by the contradiction rule.
+template <typename Bitset>
+bool Tableau<Bitset>::_apply_conjunction_rule()
+{
+  _bitset.temporary = _current.formulas;
+  _bitset.temporary &= _bitset.conjunction;
+  _bitset.temporary -= _current.processed;
+
+  if (!_bitset.temporary.any())
+    return false;
+
+  size_t one = _bitset.temporary.find_first();
+  while (one != Bitset::npos) {
+    assert(_bitset.conjunction[one]);
+    assert(_current.formulas[one]);
+    assert(!_current.processed[one]);
+
+    _add(_lhs[one], _levels[one], {FormulaID(one)});
+    _add(_rhs[one], _levels[one], {FormulaID(one)});
+    _set(PROCESSED, one);
+    one = _bitset.temporary.find_next(one);
+  }
+
+  return true;
+}
+
+template <typename Bitset>
+bool Tableau<Bitset>::_apply_always_rule()
+{
+  _bitset.temporary = _current.formulas;
+  _bitset.temporary &= _bitset.always;
+  _bitset.temporary -= _current.processed;
+
+  if (!_bitset.temporary.any())
+    return false;
+
+  size_t one = _bitset.temporary.find_first();
+  while (one != Bitset::npos) {
+    assert(_bitset.always[one]);
+    assert(_current.formulas[one]);
+    assert(!_current.processed[one]);
+
+    _add(_lhs[one], _levels[one], {FormulaID(one)});
+    assert(_bitset.tomorrow[one + 1] && _lhs[one + 1] == FormulaID(one));
+    _add(one + 1, _levels[one], {FormulaID(one)});
+    _set(PROCESSED, one);
+    one = _bitset.temporary.find_next(one);
+  }
+
+  return true;
+}
+
+// Applies the rules in the order of the strategy, up to the first choice rule
+// with a pending formula. That is the formula returned, with the alternative
+// to take first.
+template <typename Bitset>
+template <uint8_t Ops>
+FormulaID Tableau<Bitset>::_apply_expansion_rules(bool &applied, bool &second)
+{
+  using Rule = Solver::Strategy::Rule;
+  using Branching = Solver::Strategy::Branching;
+
+  bool requested = (Ops & EVENTUALITIES) &&
+                   _strategy.branching == Branching::EVENTUALITIES;
+  FormulaID choice = FormulaID::max();
+
+  for (Rule rule : _strategy.rules) {
+    if (rule == Rule::CONJUNCTION) {
+      if (_apply_conjunction_rule())
+        applied = true;
+    }
+    else if (rule == Rule::ALWAYS) {
+      if (_apply_always_rule())
+        applied = true;
+    }
+    else {
+      if (requested) {
+        requested = false;
+        if ((choice = _requested_choice(second)) != FormulaID::max())
+          break;
+      }
+
+      if ((choice = _pending_choice<Ops>(rule, second)) != FormulaID::max())
+        break;
+    }
+  }
+
+  return choice;
+}
+
+// The pending choice with an alternative fulfilling the eventuality requested
+// by the state that has waited the longest on the branch, going on with the
+// next ones if there is none. Unrelated choices are left for later.
+template <typename Bitset>
+FormulaID Tableau<Bitset>::_requested_choice(bool &second)
+{
+  _waiting.clear();
+
+  _bitset.temporary = _current.formulas;
+  _bitset.temporary &= _bitset.requesting;
+  size_t one = _bitset.temporary.find_first();
+  while (one != Bitset::npos) {
+    FormulaID eventuality = _bitset.eventually[one] ? _lhs[one] : _rhs[one];
+    if (!_current.formulas[eventuality]) {
+      size_t index = _fw_eventualities_lut[eventuality];
+      // Unfulfilled eventualities have a negative id
+      int64_t since = _stack.empty()
+                        ? -1
+                        : int64_t(_stack.top().eventualities()[index].id());
+      _waiting.emplace_back(since, index);
+    }
+    one = _bitset.temporary.find_next(one);
+  }
+
+  std::sort(_waiting.begin(), _waiting.end());
+
+  for (const auto &waiting : _waiting) {
+    for (const Fulfilment &fulfilment : _fulfilments[waiting.second]) {
+      if (_current.formulas[fulfilment.formula] &&
+          !_current.processed[fulfilment.formula]) {
+        second = fulfilment.second;
+        return fulfilment.formula;
+      }
+    }
+  }
+
+  return FormulaID::max();
+}
+
+// The pending formula of the given choice rule to branch on, if any, as
+// chosen by the branching strategy, with the alternative to take first. Ties
+// go to the first in the closure. The random branching depends only on the
+// seed and the state, so that replaying a path makes the same choices.
+template <typename Bitset>
+template <uint8_t Ops>
+FormulaID Tableau<Bitset>::_pending_choice(Solver::Strategy::Rule rule,
+                                           bool &second)
+{
+  using Rule = Solver::Strategy::Rule;
+  using Branching = Solver::Strategy::Branching;
+
+  const Bitset *formulas = nullptr;
+  switch (rule) {
+    case Rule::DISJUNCTION:
+      formulas = &_bitset.disjunction;
+      break;
+    case Rule::EVENTUALLY:
+      formulas = Ops & EVENTUALLY ? &_bitset.eventually : nullptr;
+      break;
+    case Rule::UNTIL:
+      formulas = Ops & UNTIL ? &_bitset.until : nullptr;
+      break;
+    case Rule::RELEASE:
+      formulas = Ops & RELEASE ? &_bitset.release : nullptr;
+      break;
+    case Rule::CONJUNCTION:
+    case Rule::ALWAYS:
+      assert(false);
+  }
+
+  if (!formulas)
+    return FormulaID::max();
+
+  _bitset.temporary = _current.formulas;
+  _bitset.temporary &= *formulas;
+  _bitset.temporary -= _current.processed;
+
+  size_t best = _bitset.temporary.find_first();
+  if (best == Bitset::npos)
+    return FormulaID::max();
+
+  second = _strategy.second_alternative_first;
+
+  if (_strategy.branching == Branching::MOST_CONSTRAINED ||
+      _strategy.branching == Branching::MOST_SHARED) {
+    bool fewest = _strategy.branching == Branching::MOST_CONSTRAINED;
+    const std::vector<uint32_t> &score = fewest ? _options : _sharing;
+
+    size_t one = _bitset.temporary.find_next(best);
+    while (one != Bitset::npos) {
+      if (fewest ? score[one] < score[best] : score[one] > score[best])
+        best = one;
+      one = _bitset.temporary.find_next(one);
+    }
+  }
+  else if (_strategy.branching == Branching::RANDOM) {
+    uint64_t random = mix64(_seed ^ _current.fingerprint ^ _choices.size());
+    for (size_t skip = random % _bitset.temporary.count(); skip > 0; --skip)
+      best = _bitset.temporary.find_next(best);
+  }
+
+  assert(_current.formulas[best]);
+  assert(!_current.processed[best]);
+  return FormulaID(best);
+}
+
+// Replaces the working set with the successor of the expanded state that has
+// just been pushed on the stack
+template <typename Bitset>
+void Tableau<Bitset>::_apply_step_rule()
+{
+  Frame &frame = _stack.top();
+  frame.stepped = true;
+
+  _current.id = frame.id + 1;
+  _current.processed.reset();
+  _current.requests.reset();
+  _current.fingerprint = _successor_formulas(frame, _current.formulas);
+
+  // Every formula of the successor depends on the tomorrow formula it comes
+  // from, which _successor_formulas() leaves in _bitset.temporary. The levels
+  // are all read before any is overwritten, as a tomorrow formula can be the
+  // successor of another one.
+  size_t saved = _saved_levels.size();
+  _bitset.temporary.for_each([&](size_t one) {
+    _saved_levels.push_back(uint32_t(_lhs[one]));
+    _saved_levels.push_back(_levels[one]);
+  });
+  for (size_t i = saved; i < _saved_levels.size(); i += 2) {
+    std::swap(_levels[_saved_levels[i]], _saved_levels[i + 1]);
+    _reasons[_saved_levels[i]] = {FormulaID::max()};
+  }
+  _saved_levels.push_back(uint32_t((_saved_levels.size() - saved) / 2));
+
+  _bitset.explanation.reset();
+  _learning = true;
+}
+
+// Returns the fingerprint of the successor formulas
+template <typename Bitset>
+uint64_t Tableau<Bitset>::_successor_formulas(const Frame &frame,
+                                              Bitset &formulas)
+{
+  uint64_t fingerprint = 0;
+  formulas.reset();
+
+  _bitset.temporary = frame.formulas;
+  _bitset.temporary &= _bitset.tomorrow;
+
+  size_t one = _bitset.temporary.find_first();
+  while (one != Bitset::npos) {
+    assert(frame.formulas[one]);
+    assert(_bitset.tomorrow[one]);
+    // Every formula has at most one tomorrow formula
+    assert(!formulas[_lhs[one]]);
+    formulas.set(_lhs[one]);
+    fingerprint ^= _zobrist[_lhs[one]];
+    one = _bitset.temporary.find_next(one);
+  }
+
+  return fingerprint;
+}
+
+template <typename Bitset>
+typename Tableau<Bitset>::Outcome Tableau<Bitset>::solution()
+{
+  return search();
+}
+
+template <typename Bitset>
+typename Tableau<Bitset>::Outcome
+Tableau<Bitset>::start(const WorkQueue::Path &path)
+{
+  _undo(0);
+  _choices.clear();
+  _open_from = 0;
+  _bitset.explanation.reset();
+  _replay = path;
+  _replay_pos = 0;
+  _found_model = false;
+
+  return search();
+}
+
+template <typename Bitset>
+typename Tableau<Bitset>::Outcome
+Tableau<Bitset>::split(size_t depth, std::deque<WorkQueue::Path> &cubes)
+{
+  _cubes = &cubes;
+  _split_depth = depth;
+
+  Outcome outcome = search();
+
+  _cubes = nullptr;
+
+  return outcome;
+}
+
+// The branch being abandoned is still open, so none of its frames can be
+// recorded in the _nogoods cache. What is already there stays valid, as it
+// only depends on the formulas of the states.
+template <typename Bitset>
+void Tableau<Bitset>::reset(const DynamicBitset &initial)
+{
+  if (!_stack.empty())
+    _stack.top().horizon = FrameID(0);
+
+  _undo(0);
+  _choices.clear();
+  _open_from = 0;
+  _replay.clear();
+  _replay_pos = 0;
+  _found_model = false;
+  _restarts = 0;
+  _next_restart = 0;
+
+  _set_initial_state(initial);
+}
+
+template <typename Bitset>
+typename Tableau<Bitset>::Outcome Tableau<Bitset>::search()
+{
+  if (_found_model) {
+    _found_model = false;
+    if (!_rollback_to_latest_choice())
+      return Outcome::EXHAUSTED;
+  }
+
+  _frames_limit = _solver._budget.frames / _shares;
+  if (_next_restart == 0)
+    _schedule_restart();
+
+  return (this->*_search_loop)();
+}
+
+// Without eventually and until formulas there are no eventualities: the loop
+// rule holds at the first repeated state, and the prune rules never do
+template <typename Bitset>
+void Tableau<Bitset>::_select_search_loop()
+{
+  uint8_t ops = (_solver._has_eventually ? EVENTUALLY : 0) |
+                (_solver._has_until ? UNTIL : 0) |
+                (_solver._has_release ? RELEASE : 0);
+
+  switch (ops) {
+    case 0:
+      _search_loop = &Tableau::_search<0>;
+      break;
+    case EVENTUALLY:
+      _search_loop = &Tableau::_search<EVENTUALLY>;
+      break;
+    case UNTIL:
+      _search_loop = &Tableau::_search<UNTIL>;
+      break;
+    case EVENTUALLY | UNTIL:
+      _search_loop = &Tableau::_search<EVENTUALLY | UNTIL>;
+      break;
+    case RELEASE:
+      _search_loop = &Tableau::_search<RELEASE>;
+      break;
+    case EVENTUALLY | RELEASE:
+      _search_loop = &Tableau::_search<EVENTUALLY | RELEASE>;
+      break;
+    case UNTIL | RELEASE:
+      _search_loop = &Tableau::_search<UNTIL | RELEASE>;
+      break;
+    default:
+      _search_loop = &Tableau::_search<EVENTUALLY | UNTIL | RELEASE>;
+      break;
+  }
+}
+
+// Without eventualities, every state crossed is recorded in the _nogoods, and
+// never looked at again once there: the cache is then the set of the states
+// visited by the search. Its budget is counted in states, so that it does not
+// shrink as the closure grows. Past it, the states evicted are searched again
+// when reached, which costs time but not soundness.
+template <typename Bitset>
+size_t Tableau<Bitset>::_nogoods_budget(const Solver &solver, uint32_t shares)
+{
+  if (!solver._has_eventually && !solver._has_until)
+    return VISITED_STATES *
+           NogoodCache<Bitset>::slot_bytes(solver._number_of_formulas) /
+           shares;
+
+  return NOGOOD_CACHE_BYTES / shares;
+}
+
+template <typename Bitset>
+template <uint8_t Ops>
+typename Tableau<Bitset>::Outcome Tableau<Bitset>::_search()
+{
+  bool rules_applied;
+  FormulaID choice;
+  bool second = false;
+  uint32_t level;
+
+  while (true) {
+    if (_queue && _queue->cancelled())
+      return Outcome::CANCELLED;
+
+    if (__builtin_expect(_out_of_budget(), 0)) {
+      if (_queue)
+        _queue->cancel();
+      return Outcome::INTERRUPTED;
+    }
+
+    if (__builtin_expect(_stats.total_frames >= _next_restart, 0))
+      _restart();
+
+    rules_applied = true;
+    while (rules_applied) {
+      rules_applied = false;
+
+      if (__builtin_expect(_current.formulas.none(), 0)) {
+        _loop_state = _stack.top().id;
+        _model_size = _stack.size();
+        _stack.top().horizon = FrameID(0);
+        _found_model = true;
+        _next_restart = UINT64_MAX;
+        _unexplain_branch();
+
+        return Outcome::SATISFIABLE;
+      }
+
+      if (_check_contradiction_rule()) {
+        ++_stats.total_frames;
+        ++_stats.cross_by_contradiction;
+        if (!_rollback_to_latest_choice(_contradiction_level()))
+          return Outcome::EXHAUSTED;
+        rules_applied = true;
+        continue;
+      }
+
+      choice = _apply_expansion_rules<Ops>(rules_applied, second);
+      if (choice == FormulaID::max())
+        continue;
+
+      switch (_apply_propagation_rule<Ops>(choice, level, second)) {
+        case Propagation::CONFLICT:
+          ++_stats.total_frames;
+          ++_stats.cross_by_contradiction;
+          if (!_rollback_to_latest_choice(level))
+            return Outcome::EXHAUSTED;
+          rules_applied = true;
+          continue;
+        case Propagation::APPLIED:
+          rules_applied = true;
+          continue;
+        case Propagation::NONE:
+          break;
+      }
+
+      if (_check_propositional_rule()) {
+        ++_stats.total_frames;
+        ++_stats.cross_by_contradiction;
+        if (!_rollback_to_latest_choice())
+          return Outcome::EXHAUSTED;
+        rules_applied = true;
+        continue;
+      }
+
+      if (_check_learned_rule(level)) {
+        ++_stats.total_frames;
+        ++_stats.clause_hits;
+        if (!_rollback_to_latest_choice(level))
+          return Outcome::EXHAUSTED;
+        rules_applied = true;
+        continue;
+      }
+
+      if (__builtin_expect(_cubes && _choices.size() >= _split_depth, 0)) {
+        _cut();
+        if (!_rollback_to_latest_choice())
+          return Outcome::EXHAUSTED;
+        rules_applied = true;
+        continue;
+      }
+
+      // TODO: Don't generate eventualities here at all
+      _set(PROCESSED, choice);
+      _request_eventuality<Ops>(choice);
+      _push_choice(choice, second);
+      rules_applied = true;
+    }
+
+    Frame *chain = _stack.empty() ? nullptr : &_stack.top();
+    _stack.emplace(_current.id, _current.formulas, _current.fingerprint,
+                   _current.processed, _current.requests, chain,
+                   _bw_eventualities_lut.size());
+    _trail.push_back(STEP);
+
+    // This branch of the state is not crossed by a contradiction
+    _unexplain_branch();
+
+    // The subtree of a frame met while replaying is not ours alone
+    if (__builtin_expect(_replay_pos < _replay.size(), 0))
+      _stack.top().horizon = FrameID(0);
+
+    _update_history();
+    if (Ops & EVENTUALITIES)
+      _update_eventualities();
+
+    bool loop_result = false;
+
+    if (Ops & EVENTUALITIES)
+      std::tie(loop_result, _loop_state) = _check_loop_rule();
+    else if ((loop_result = _stack.top().first != &_stack.top()))
+      _loop_state = _stack.top().first->id;
+
+    if (loop_result) {
+      _model_size = _stack.size() - 1;
+      _stack.top().horizon = FrameID(0);
+
+      __dump_current_branch();
+      _found_model = true;
+      _next_restart = UINT64_MAX;
+
+      return Outcome::SATISFIABLE;
+    }
+
+    if ((Ops & EVENTUALITIES) &&
+        (_check_prune0_rule() || _check_prune_rule())) {
+      ++_stats.total_frames;
+      ++_stats.cross_by_prune;
+      if (!_rollback_to_latest_choice())
+        return Outcome::EXHAUSTED;
+      continue;
+    }
+
+    if (_stack.top().id >= _solver._maximum_depth) {
+      _stack.top().horizon = FrameID(0);
+      ++_stats.total_frames;
+      ++_stats.cross_by_depth;
+      if (!_rollback_to_latest_choice())
+        return Outcome::EXHAUSTED;
+      continue;
+    }
+
+    _apply_step_rule();
+
+    ++_stats.total_frames;
+    ++_stats.total_steps;
+
+    _stats.maximum_model_size =
+      std::max(_stats.maximum_model_size, static_cast<uint64_t>(_current.id));
+
+    // The formulas are unsatisfiable by themselves
+    if (_nogoods.contains(_current.formulas)) {
+      ++_stats.cache_hits;
+      _learning = false;
+      if (!_rollback_to_latest_choice(_formulas_level()))
+        return Outcome::EXHAUSTED;
+      continue;
+    }
+    ++_stats.cache_misses;
+  }
+}
+
+// Records the eventualities fulfilled by the top frame, and computes the ones
+// fulfilled since its first and its prev frame, a block at a time
+template <typename Bitset>
+void Tableau<Bitset>::_update_eventualities()
+{
+  Frame &frame = _stack.top();
+  ArrayRef<Eventuality> evs = frame.eventualities();
+  uint64_t *fulfilled = frame.fulfilled().blocks();
+  uint64_t *since_prev = _since_prev.blocks();
+
+  int64_t first = frame.first->id;
+  int64_t prev = frame.prev->id;
+
+  for (size_t block = 0; block * BITS_PER_BLOCK < evs.size(); ++block) {
+    size_t end = std::min(evs.size(), (block + 1) * BITS_PER_BLOCK);
+    uint64_t fulfilled_block = 0;
+    uint64_t since_prev_block = 0;
+
+    for (size_t i = block * BITS_PER_BLOCK; i < end; ++i) {
+      if (frame.formulas[_bw_eventualities_lut[i]])
+        evs[i].set_satisfied(frame.id);
+
+      // Unsatisfied eventualities have a negative id
+      int64_t id = evs[i].id();
+      uint64_t bit = uint64_t(1) << (i % BITS_PER_BLOCK);
+      fulfilled_block |= id >= first ? bit : 0;
+      since_prev_block |= id > prev ? bit : 0;
+    }
+
+    fulfilled[block] = fulfilled_block;
+    since_prev[block] = since_prev_block;
+  }
+}
+
+// Looks for the latest frame of the branch with the same formulas as the top
+// one among those with the same fingerprint, and adds the top one to them
+template <typename Bitset>
+void Tableau<Bitset>::_update_history()
+{
+  Frame &top_frame = _stack.top();
+  Frame *current_frame = _branch.find(top_frame.fingerprint);
+
+  top_frame.prev = &top_frame;
+  top_frame.first = &top_frame;
+
+  while (current_frame) {
+    if (current_frame->formulas == top_frame.formulas) {
+      top_frame.prev = current_frame;
+      top_frame.first = current_frame->first;
+      break;
+    }
+
+    current_frame = current_frame->same;
+  }
+
+  _branch.push(top_frame, _stack);
+}
+
+// Every requested eventuality has been fulfilled inside the loop
+template <typename Bitset>
+std::pair<bool, FrameID> Tableau<Bitset>::_check_loop_rule() const
+{
+  const Frame &frame = _stack.top();
+
+  if (frame.first == &frame)
+    return std::make_pair(false, FrameID(0));
+
+  return std::make_pair(frame.requests().is_subset_of(frame.fulfilled()),
+                        frame.first->id);
+}
+
+// No requested eventuality has been fulfilled since the prev frame
+template <typename Bitset>
+bool Tableau<Bitset>::_check_prune0_rule() const
+{
+  const Frame &frame = _stack.top();
+
+  if (frame.prev == &frame)
+    return false;
+
+  return !frame.requests().intersects(_since_prev);
+}
+
+// Every requested eventuality fulfilled since the prev frame had already been
+// fulfilled between the first and the prev one
+template <typename Bitset>
+bool Tableau<Bitset>::_check_prune_rule()
+{
+  const Frame &frame = _stack.top();
+
+  if (frame.prev == frame.first)
+    return false;
+
+  assert(frame.prev->first == frame.first);
+  _ev_temporary.assign(frame.requests());
+  _ev_temporary &= _since_prev;
+  return _ev_temporary.is_subset_of(frame.prev->fulfilled());
+}
+
+// Goes back to the most recent choice which still has an alternative to
+// explore, and switches to it. Returns false if there is none left, i.e. the
+// whole tableau has been explored.
+template <typename Bitset>
+bool Tableau<Bitset>::_rollback_to_latest_choice()
+{
+  return _rollback_to_latest_choice(uint32_t(_choices.size()));
+}
+
+// Same as above, after a cross depending only on the first level choices.
+// The ones after them are closed whatever alternative they are exploring.
+template <typename Bitset>
+bool Tableau<Bitset>::_rollback_to_latest_choice(uint32_t level)
+{
+  bool jumped = false;
+  while (_choices.size() > level) {
+    jumped = jumped || _choices.back().open;
+    _pop_choice();
+  }
+
+  if (jumped)
+    ++_stats.backjumps;
+
+  while (true) {
+    // Leaving the state, when its every branch has been explained
+    if (_learning &&
+        (_choices.empty() || _choices.back().frames < _stack.size())) {
+      _lift(_bitset.explanation, 0);
+      _learn(_bitset.explanation);
+      _learning = false;
+    }
+
+    if (_choices.empty())
+      return false;
+
+    Choice &choice = _choices.back();
+
+    if (choice.open) {
+      if (choice.explained)
+        _lift(_explanations[_choices.size() - 1], choice.trail_size);
+
+      _undo(choice.trail_size);
+      choice.second = !choice.second;
+      choice.open = false;
+      _apply_alternative(choice.formula, choice.second,
+                         uint32_t(_choices.size()));
+
+      return true;
+    }
+
+    _pop_choice();
+  }
+}
+
+// The seed of the random branching changes at every restart, but it is the
+// same in every worker of a parallel search, which never restarts, and in
+// every cube of a split one, which doesn't either
+template <typename Bitset>
+void Tableau<Bitset>::_schedule_restart()
+{
+  using Restarts = Solver::Strategy::Restarts;
+
+  _seed = mix64(_strategy.seed + _restarts);
+
+  uint64_t interval = UINT64_MAX;
+  if (_strategy.restarts == Restarts::LUBY)
+    interval = _strategy.restart_interval * luby(_restarts);
+  else if (_strategy.restarts == Restarts::GEOMETRIC) {
+    double frames =
+      double(_strategy.restart_interval) * std::pow(1.5, double(_restarts));
+    if (frames < double(UINT64_MAX / 2))
+      interval = uint64_t(frames);
+  }
+
+  _next_restart = _queue || _cubes || interval == UINT64_MAX
+                    ? UINT64_MAX
+                    : _stats.total_frames + std::max(interval, uint64_t(1));
+}
+
+// Abandons the branch, which is still open, so none of its frames can be
+// recorded in the _nogoods cache, as in reset()
+template <typename Bitset>
+void Tableau<Bitset>::_restart()
+{
+  if (!_stack.empty())
+    _stack.top().horizon = FrameID(0);
+
+  _undo(0);
+  _choices.clear();
+  _open_from = 0;
+  _bitset.explanation.reset();
+  _learning = true;
+
+  ++_restarts;
+  ++_stats.restarts;
+  _schedule_restart();
+}
+
+// The frames and memory budgets are split evenly among the workers
+template <typename Bitset>
+bool Tableau<Bitset>::_out_of_budget()
+{
+  const Solver::Budget &budget = _solver._budget;
+
+  if (_stats.total_frames >= _frames_limit ||
+      (budget.cancel && budget.cancel->load(std::memory_order_relaxed)))
+    return true;
+
+  if (--_budget_countdown > 0)
+    return false;
+  _budget_countdown = BUDGET_CHECK_INTERVAL;
+
+  return _memory_usage() >= budget.memory / _shares ||
+         Solver::Clock::now() >= budget.deadline;
+}
+
+template <typename Bitset>
+size_t Tableau<Bitset>::_memory_usage() const
+{
+  return _stack.allocated_bytes() + _nogoods.allocated_bytes() +
+         _learned.allocated_bytes() + _branch.allocated_bytes() + _trail.capacity() * sizeof(uint64_t) +
+         _choices.capacity() * sizeof(Choice);
+}
+
+template <typename Bitset>
+ModelPtr Tableau<Bitset>::model() const
+{
+  ModelPtr model = std::make_shared<Model>();
+
+  for (size_t i = 0; i < _model_size; ++i) {
+    const Frame &frame = _stack[i];
+
+    LTL::detail::State state;
+    for (uint64_t j = 0; j < _number_of_formulas; ++j) {
+      if (frame.formulas[j]) {
+        auto atom = _solver._atom_set.find(FormulaID(j));
+        if (atom != _solver._atom_set.end())
+          state.insert(Literal(atom->second));
+        else if (_solver._bitset.negation[j]) {
+          atom = _solver._atom_set.find(_lhs[j]);
+          if (atom != _solver._atom_set.end())
+            state.insert(Literal(atom->second, false));
+        }
+      }
+    }
+
+    model->states.push_back(state);
+  }
+
+  model->loop_state = _loop_state;
+
+  return model;
+}
+
+template <typename Bitset>
+void Tableau<Bitset>::__dump_frame(Frame const *frame) const
+{
+  format::verbose("Frame n. {}", (size_t)frame->id);
+  format::verbose("Prev frame n. {}", (size_t)frame->prev->id);
+  format::verbose("First frame n. {}", (size_t)frame->first->id);
+  __dump_frame_formulas(frame);
+
+  format::verbose("- Eventualities:");
+  __dump_requested_eventualities(frame);
+  __dump_satisfied_eventualities(frame);
+
+  format::verbose("");
+}
+
+template <typename Bitset>
+void Tableau<Bitset>::__dump_frame_formulas(Frame const *frame) const
+{
+  PrettyPrinter p;
+  format::verbose("- Formulas:");
+  for (uint64_t i = 0; i < _number_of_formulas; ++i)
+    if (frame->formulas[i])
+      format::verbose("  - {}", p.to_string(_solver._subformulas[i]));
+}
+
+template <typename Bitset>
+void Tableau<Bitset>::__dump_satisfied_eventualities(Frame const *frame) const
+{
+  PrettyPrinter p;
+  size_t i = 0;
+
+  format::verbose("  - Satisfied: ");
+  for (Eventuality ev : frame->eventualities()) {
+    if (ev.is_satisfied() && ev.id() >= frame->first->id)
+      format::verbose(
+        "    - {} at {}",
+        p.to_string(_solver._subformulas[_bw_eventualities_lut[i]]),
+        (size_t)ev.id());
+    ++i;
+  }
+}
+
+template <typename Bitset>
+void Tableau<Bitset>::__dump_requested_eventualities(Frame const *frame) const
+{
+  PrettyPrinter p;
+
+  format::verbose("  - Requested:");
+  for (size_t i = 0; i < _bw_eventualities_lut.size(); ++i) {
+    if (frame->requests()[i])
+      format::verbose(
+        "    - {}", p.to_string(_solver._subformulas[_bw_eventualities_lut[i]]));
+  }
+}
+
+template <typename Bitset>
+void Tableau<Bitset>::__dump_current_branch() const
+{
+  if (format::verbosity_level() < format::Verbose)
+    return;
+
+  std::deque<Frame const *> frames;
+  Frame const *current_frame = &_stack.top();
+
+  while (current_frame) {
+    frames.push_front(current_frame);
+    current_frame = current_frame->chain;
+  }
+
+  for (Frame const *frame : frames) {
+    __dump_frame(frame);
+  }
+}
+}
+}
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <stack>
+
 template <class T, class S>
 inline const S &Container(const std::stack<T, S> &s)
 {
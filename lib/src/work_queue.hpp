@@ -0,0 +1,142 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace LTL {
+namespace detail {
+
+/*
+ * Tasks shared between the workers of the parallel tableau.
+ *
+ * A task is the subtree following an open choice of some worker, described
+ * by the alternatives taken at every choice from the initial state down to
+ * it. Busy workers only give tasks away when someone is waiting for one, so
+ * that the queue holds a handful of big subtrees rather than many small ones.
+ *
+ * The search is over when every worker is idle with nothing left in the
+ * queue, or when it is cancelled because someone has found a model.
+ */
+class WorkQueue {
+public:
+  using Path = std::vector<bool>;
+
+  WorkQueue()
+    : _mutex(),
+      _changed(),
+      _tasks(),
+      _busy(0),
+      _hungry(0),
+      _pending(0),
+      _cancelled(false)
+  {
+  }
+
+  WorkQueue(const WorkQueue &) = delete;
+  WorkQueue &operator=(const WorkQueue &) = delete;
+
+  // Waits for a task and takes it. Returns false if the search is over.
+  bool take(Path &path)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    ++_hungry;
+    _changed.wait(lock, [this] {
+      return _cancelled || !_tasks.empty() || _busy == 0;
+    });
+    --_hungry;
+
+    if (_cancelled || _tasks.empty())
+      return false;
+
+    path = std::move(_tasks.front());
+    _tasks.pop_front();
+    --_pending;
+    ++_busy;
+
+    return true;
+  }
+
+  void give(Path path)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _tasks.push_back(std::move(path));
+    ++_pending;
+    _changed.notify_one();
+  }
+
+  // Called by a worker when it has exhausted the task it had taken
+  void finish()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    assert(_busy > 0);
+    if (--_busy == 0)
+      _changed.notify_all();
+  }
+
+  // Checked by busy workers at every choice, so it doesn't take the lock
+  bool wants_work() const
+  {
+    return _hungry.load(std::memory_order_relaxed) >
+           _pending.load(std::memory_order_relaxed);
+  }
+
+  void cancel()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _cancelled = true;
+    _changed.notify_all();
+  }
+
+  // Lets the workers go on with the tasks they had when cancelled
+  void resume() { _cancelled = false; }
+
+  // Forgets every task, taken or not. Only called with no worker running.
+  void clear()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _tasks.clear();
+    _busy = 0;
+    _pending = 0;
+    _cancelled = false;
+  }
+
+  bool cancelled() const { return _cancelled.load(std::memory_order_relaxed); }
+
+private:
+  std::mutex _mutex;
+  std::condition_variable _changed;
+  std::deque<Path> _tasks;
+  size_t _busy;
+
+  std::atomic<size_t> _hungry;
+  std::atomic<size_t> _pending;
+  std::atomic<bool> _cancelled;
+};
+}
+}
@@ -0,0 +1,156 @@
+/*
+  Copyright (c) 2014, Matteo Bertello
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * The names of its contributors may not be used to endorse or promote
+    products derived from this software without specific prior written
+    permission.
+*/
+
+/*
+ * Uses of the library that the checker does not make, each one going
+ * through several searches on the same Solver.
+ */
+
+#include "leviathan.hpp"
+
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static LTL::FormulaPtr parse(const std::string &input)
+{
+  std::stringstream stream(input);
+  LTL::Parser parser(stream, [&](std::string err) {
+    std::cerr << "Syntax error in " << input << ": " << err << "\n";
+    std::exit(EXIT_FAILURE);
+  });
+
+  return parser.parseFormula();
+}
+
+using Result = LTL::Solver::Result;
+
+// Subsets of the same assumptions, as when checking which ones are consistent
+// with a specification
+static bool assumptions()
+{
+  LTL::Solver solver(parse("G (p -> X q)"),
+                     {parse("p"), parse("G !q"), parse("G F p"),
+                      parse("r & !r"), parse("F G q")});
+
+  struct Case
+  {
+    std::vector<size_t> assumptions;
+    Result expected;
+  };
+
+  std::vector<Case> cases = {
+    {{}, Result::SATISFIABLE},
+    {{0, 1}, Result::UNSATISFIABLE},
+    {{0}, Result::SATISFIABLE},
+    {{1}, Result::SATISFIABLE},
+    {{1, 2}, Result::UNSATISFIABLE},
+    {{2, 4}, Result::SATISFIABLE},
+    {{3}, Result::UNSATISFIABLE},
+    {{0, 4}, Result::SATISFIABLE},
+    {{1, 4}, Result::UNSATISFIABLE},
+    {{}, Result::SATISFIABLE},
+  };
+
+  bool failed = false;
+  for (const Case &c : cases) {
+    Result result = solver.solve(c.assumptions);
+    if (result != c.expected) {
+      std::cerr << "Wrong result under the assumptions {";
+      for (size_t i : c.assumptions)
+        std::cerr << " " << i;
+      std::cerr << " }\n";
+      failed = true;
+    }
+  }
+
+  // With every assumption at once
+  if (solver.solve({0, 1, 2, 3, 4}) != Result::UNSATISFIABLE) {
+    std::cerr << "Wrong result under every assumption\n";
+    failed = true;
+  }
+
+  return !failed;
+}
+
+// Searches after the shortest model, which go back to the engine the formula
+// had before looking for it
+static bool shortest_then_solve()
+{
+  LTL::Solver solver(parse("G F p & G F q & G (p -> X !p) & F G !r"),
+                     {parse("G !p"), parse("q")});
+
+  if (solver.solve({1}) != Result::SATISFIABLE) {
+    std::cerr << "Wrong result before the shortest model\n";
+    return false;
+  }
+
+  LTL::ModelPtr shortest = solver.shortest_model();
+  if (!shortest || shortest->states.size() != 2) {
+    std::cerr << "Wrong shortest model\n";
+    return false;
+  }
+
+  if (solver.solve({1}) != Result::SATISFIABLE || !solver.next_model()) {
+    std::cerr << "No model after the shortest one\n";
+    return false;
+  }
+
+  if (solver.solve({0}) != Result::UNSATISFIABLE) {
+    std::cerr << "Wrong result after the shortest model\n";
+    return false;
+  }
+
+  return true;
+}
+
+// Cubes asked for by a program with another thread running, which the Solver
+// then searches by itself instead of forking workers
+static bool cubes_with_threads()
+{
+  std::promise<void> stop;
+  std::thread other([done = stop.get_future()] { done.wait(); });
+
+  LTL::Solver sat(
+    parse("G (a | b) & G (c | d) & G (e | f) & F (a & c & e) & G F !a"));
+  LTL::Solver unsat(
+    parse("G (a | b) & G (c | d) & G (e | f) & G !b & G !d & F (!a | !c)"));
+  sat.set_cubes({3, 2});
+  unsat.set_cubes({3, 2});
+
+  bool passed = sat.solution() == Result::SATISFIABLE && sat.model() &&
+                unsat.solution() == Result::UNSATISFIABLE;
+  if (!passed)
+    std::cerr << "Wrong result of the cubes with threads\n";
+
+  stop.set_value();
+  other.join();
+
+  return passed;
+}
+
+int main()
+{
+  bool passed = assumptions();
+  passed = shortest_then_solve() && passed;
+  passed = cubes_with_threads() && passed;
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}